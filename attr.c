@@ -3,6 +3,359 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(CONFIG_KVSTORE_ATTR_CACHE)
+
+#include <pthread.h>
+
+/******************************************************************************
+ * Attribute read cache
+ *
+ * Values of attributes identified by attr_id < nr are cached into a dense array
+ * of slots, each protected by a sequence counter (version stamp) so that
+ * lookups are lock free: writers make it odd while updating a slot and readers
+ * retry from libdb when it changed under them.
+ *
+ * Writers mark slots dirty before updating a record, which makes lookups bypass
+ * the cache until the outermost writing transaction is resolved. The slot is
+ * then invalidated at commit time or left as is when rolled back since
+ * committed value did not change. Marked slots are tracked into a list of
+ * pending entries hanging off the outermost libdb transaction handle (see
+ * DB_TXN->app_private) so that no global state is shared between writers.
+ *
+ * A slot is filled after a miss only if its version did not change since
+ * lookup, i.e. if no writer showed up meanwhile.
+ ******************************************************************************/
+
+#define KVS_ATTR_CACHE_WORDS \
+	(KVS_ATTR_CACHE_SIZE_MAX / sizeof(uint64_t))
+
+struct kvs_attr_slot {
+	unsigned long seq;
+	unsigned int  dirty;
+	unsigned int  size;
+	uint64_t      data[KVS_ATTR_CACHE_WORDS];
+};
+
+struct kvs_attr_cache {
+	pthread_mutex_t      lock;
+	unsigned int         nr;
+	struct kvs_attr_slot slots[];
+};
+
+struct kvs_attr_pend {
+	struct kvs_attr_pend  *next;
+	struct kvs_attr_cache *cache;
+	unsigned int           nr;
+	unsigned int           ids[];
+};
+
+static void
+kvs_attr_slot_write_begin(struct kvs_attr_slot *slot)
+{
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void
+kvs_attr_slot_write_end(struct kvs_attr_slot *slot)
+{
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Return cache to use for given attribute and transaction, if any.
+ *
+ * Snapshot transactions must not see values committed after they started:
+ * bypass cache for them.
+ */
+static struct kvs_attr_cache *
+kvs_attr_cache_of(const struct kvs_store *store,
+                  const struct kvs_xact  *xact,
+                  unsigned int            attr_id)
+{
+	struct kvs_attr_cache *cache = store->db->app_private;
+
+	if (!cache || (attr_id >= cache->nr))
+		return NULL;
+
+	do {
+		if (xact->flags & KVS_XACT_SNAPSHOT)
+			return NULL;
+		xact = xact->parent;
+	} while (xact);
+
+	return cache;
+}
+
+/*
+ * Lookup cached value into a buffer of size bytes. Returns value size or 0 on
+ * miss, in which case seq holds version to give to kvs_attr_cache_fill().
+ */
+static size_t
+kvs_attr_cache_get(struct kvs_attr_cache *cache,
+                   unsigned int           attr_id,
+                   void                  *data,
+                   size_t                 size,
+                   unsigned long         *seq)
+{
+	const struct kvs_attr_slot *slot = &cache->slots[attr_id];
+	uint64_t                    buff[KVS_ATTR_CACHE_WORDS];
+	unsigned long               start;
+	size_t                      sz;
+	unsigned int                w;
+
+	start = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+	*seq = start;
+	if ((start & 1) || __atomic_load_n(&slot->dirty, __ATOMIC_RELAXED))
+		return 0;
+
+	sz = __atomic_load_n(&slot->size, __ATOMIC_RELAXED);
+	for (w = 0; w < KVS_ATTR_CACHE_WORDS; w++)
+		buff[w] = __atomic_load_n(&slot->data[w], __ATOMIC_RELAXED);
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != start)
+		return 0;
+
+	/* Let libdb report errors when value does not fit. */
+	if (!sz || (sz > size))
+		return 0;
+
+	memcpy(data, buff, sz);
+
+	return sz;
+}
+
+static void
+kvs_attr_cache_fill(struct kvs_attr_cache *cache,
+                    unsigned int           attr_id,
+                    unsigned long          seq,
+                    const void            *data,
+                    size_t                 size)
+{
+	struct kvs_attr_slot *slot = &cache->slots[attr_id];
+	uint64_t              buff[KVS_ATTR_CACHE_WORDS] = { 0, };
+	unsigned int          w;
+
+	if (!size || (size > sizeof(buff)))
+		return;
+
+	memcpy(buff, data, size);
+
+	pthread_mutex_lock(&cache->lock);
+
+	if ((slot->seq == seq) && !slot->dirty) {
+		kvs_attr_slot_write_begin(slot);
+		__atomic_store_n(&slot->size, (unsigned int)size,
+		                 __ATOMIC_RELAXED);
+		for (w = 0; w < KVS_ATTR_CACHE_WORDS; w++)
+			__atomic_store_n(&slot->data[w], buff[w],
+			                 __ATOMIC_RELAXED);
+		kvs_attr_slot_write_end(slot);
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+}
+
+static void
+kvs_attr_cache_mark(struct kvs_attr_cache *cache,
+                    const unsigned int    *attr_ids,
+                    unsigned int           nr,
+                    bool                   dirty,
+                    bool                   invalidate)
+{
+	unsigned int a;
+
+	pthread_mutex_lock(&cache->lock);
+
+	for (a = 0; a < nr; a++) {
+		struct kvs_attr_slot *slot = &cache->slots[attr_ids[a]];
+
+		kvs_attr_slot_write_begin(slot);
+		__atomic_store_n(&slot->dirty,
+		                 dirty ? slot->dirty + 1 : slot->dirty - 1,
+		                 __ATOMIC_RELAXED);
+		if (invalidate)
+			__atomic_store_n(&slot->size, 0, __ATOMIC_RELAXED);
+		kvs_attr_slot_write_end(slot);
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/*
+ * Mark attribute slots dirty on behalf of the outermost transaction of xact
+ * before updating them.
+ *
+ * Attributes updated multiple times within the same transaction are given one
+ * entry each: since dirty counts are balanced at resolution time, this is
+ * cheaper than looking for duplicates.
+ */
+static int
+kvs_attr_cache_hold(const struct kvs_store *store,
+                    const struct kvs_xact  *xact,
+                    const unsigned int     *attr_ids,
+                    unsigned int            nr)
+{
+	struct kvs_attr_cache  *cache = store->db->app_private;
+	struct kvs_attr_pend   *pend;
+	struct kvs_attr_pend  **head;
+	unsigned int            cnt = 0;
+	unsigned int            a;
+
+	if (!cache)
+		return 0;
+
+	for (a = 0; a < nr; a++)
+		if (attr_ids[a] < cache->nr)
+			cnt++;
+	if (!cnt)
+		return 0;
+
+	pend = malloc(sizeof(*pend) + (cnt * sizeof(pend->ids[0])));
+	if (!pend)
+		return -ENOMEM;
+
+	pend->cache = cache;
+	pend->nr = 0;
+	for (a = 0; a < nr; a++)
+		if (attr_ids[a] < cache->nr)
+			pend->ids[pend->nr++] = attr_ids[a];
+
+	kvs_attr_cache_mark(cache, pend->ids, pend->nr, true, false);
+
+	while (xact->parent)
+		xact = xact->parent;
+
+	/* Threads may share a transaction: push entry lock free. */
+	head = (struct kvs_attr_pend **)&xact->txn->app_private;
+	pend->next = __atomic_load_n(head, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(head,
+	                                    &pend->next,
+	                                    pend,
+	                                    true,
+	                                    __ATOMIC_RELEASE,
+	                                    __ATOMIC_RELAXED))
+		;
+
+	return 0;
+}
+
+/*
+ * Detach entries pending on behalf of an outermost transaction about to be
+ * resolved, i.e. before its handle gets released and possibly reused by a new
+ * transaction.
+ */
+struct kvs_attr_pend *
+kvs_attr_detach_cache(DB_TXN *txn)
+{
+	return __atomic_exchange_n((struct kvs_attr_pend **)&txn->app_private,
+	                           NULL,
+	                           __ATOMIC_ACQUIRE);
+}
+
+/* Release detached entries once their transaction is resolved. */
+void
+kvs_attr_release_cache(struct kvs_attr_pend *list, bool invalidate)
+{
+	while (list) {
+		struct kvs_attr_pend *pend = list;
+
+		list = pend->next;
+
+		kvs_attr_cache_mark(pend->cache,
+		                    pend->ids,
+		                    pend->nr,
+		                    false,
+		                    invalidate);
+		free(pend);
+	}
+}
+
+int
+kvs_attr_enable_cache(const struct kvs_store *store, unsigned int nr)
+{
+	kvs_assert(store);
+	kvs_assert(store->db);
+	kvs_assert(nr);
+	kvs_assert(nr < UINT_MAX);
+
+	struct kvs_attr_cache *cache;
+
+	if (store->db->app_private)
+		return -EALREADY;
+
+	cache = calloc(1, sizeof(*cache) + (nr * sizeof(cache->slots[0])));
+	if (!cache)
+		return -ENOMEM;
+
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->nr = nr;
+
+	store->db->app_private = cache;
+
+	return 0;
+}
+
+void
+kvs_attr_disable_cache(const struct kvs_store *store)
+{
+	kvs_assert(store);
+	kvs_assert(store->db);
+
+	struct kvs_attr_cache *cache = store->db->app_private;
+
+	if (!cache)
+		return;
+
+	store->db->app_private = NULL;
+
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+#else  /* !defined(CONFIG_KVSTORE_ATTR_CACHE) */
+
+struct kvs_attr_cache;
+
+static inline struct kvs_attr_cache *
+kvs_attr_cache_of(const struct kvs_store *store __unused,
+                  const struct kvs_xact  *xact __unused,
+                  unsigned int            attr_id __unused)
+{
+	return NULL;
+}
+
+static inline size_t
+kvs_attr_cache_get(struct kvs_attr_cache *cache __unused,
+                   unsigned int           attr_id __unused,
+                   void                  *data __unused,
+                   size_t                 size __unused,
+                   unsigned long         *seq __unused)
+{
+	return 0;
+}
+
+static inline void
+kvs_attr_cache_fill(struct kvs_attr_cache *cache __unused,
+                    unsigned int           attr_id __unused,
+                    unsigned long          seq __unused,
+                    const void            *data __unused,
+                    size_t                 size __unused)
+{
+}
+
+static inline int
+kvs_attr_cache_hold(const struct kvs_store *store __unused,
+                    const struct kvs_xact  *xact __unused,
+                    const unsigned int     *attr_ids __unused,
+                    unsigned int            nr __unused)
+{
+	return 0;
+}
+
+#endif /* defined(CONFIG_KVSTORE_ATTR_CACHE) */
+
 /******************************************************************************
  * Attribute store / iterator handling
  ******************************************************************************/
@@ -27,9 +380,10 @@ kvs_attr_iter_get_elem(const DBT                 *key,
 	return 0;
 }
 
-int
-kvs_attr_iter_first(const struct kvs_iter     *iter,
-                    struct kvs_attr_iter_elem *elem)
+static int
+kvs_attr_iter_goto(const struct kvs_iter     *iter,
+                   struct kvs_attr_iter_elem *elem,
+                   kvs_iter_goto_fn          *iter_goto)
 {
 	kvs_assert(elem);
 
@@ -37,28 +391,39 @@ kvs_attr_iter_first(const struct kvs_iter     *iter,
 	DBT item = { 0, };
 	int err;
 
-	err = kvs_iter_goto_first(iter, &key, &item);
+	err = iter_goto(iter, &key, &item);
 	if (err)
 		return err;
 
 	return kvs_attr_iter_get_elem(&key, &item, elem);
 }
 
+int
+kvs_attr_iter_first(const struct kvs_iter     *iter,
+                    struct kvs_attr_iter_elem *elem)
+{
+	return kvs_attr_iter_goto(iter, elem, kvs_iter_goto_first);
+}
+
 int
 kvs_attr_iter_next(const struct kvs_iter     *iter,
                    struct kvs_attr_iter_elem *elem)
 {
-	kvs_assert(elem);
-
-	DBT key = { 0, };
-	DBT item = { 0, };
-	int err;
+	return kvs_attr_iter_goto(iter, elem, kvs_iter_goto_next);
+}
 
-	err = kvs_iter_goto_next(iter, &key, &item);
-	if (err)
-		return err;
+int
+kvs_attr_iter_last(const struct kvs_iter     *iter,
+                   struct kvs_attr_iter_elem *elem)
+{
+	return kvs_attr_iter_goto(iter, elem, kvs_iter_goto_last);
+}
 
-	return kvs_attr_iter_get_elem(&key, &item, elem);
+int
+kvs_attr_iter_prev(const struct kvs_iter     *iter,
+                   struct kvs_attr_iter_elem *elem)
+{
+	return kvs_attr_iter_goto(iter, elem, kvs_iter_goto_prev);
 }
 
 int
@@ -69,45 +434,107 @@ kvs_attr_init_iter(const struct kvs_store *store,
 	return kvs_init_iter(store, xact, iter);
 }
 
+int
+kvs_attr_init_bulk_iter(const struct kvs_store *store,
+                        const struct kvs_xact  *xact,
+                        struct kvs_iter        *iter,
+                        size_t                  size)
+{
+	return kvs_init_bulk_iter(store, xact, iter, size);
+}
+
 int
 kvs_attr_fini_iter(const struct kvs_iter *iter)
 {
 	return kvs_fini_iter(iter);
 }
 
-static const void *
+static int
 kvs_attr_load_num(const struct kvs_store *store,
                   const struct kvs_xact  *xact,
                   unsigned int            attr_id,
+                  void                   *num,
                   size_t                  size)
 {
 	kvs_assert(attr_id < UINT_MAX);
+	kvs_assert(num);
 	kvs_assert(size);
+	kvs_assert(size <= (2 * sizeof(uint64_t)));
+
+	/* Large enough for the largest numeric type, i.e. an IPv6 address. */
+	uint64_t               buff[2];
+	struct kvs_attr_cache *cache = kvs_attr_cache_of(store, xact, attr_id);
+	unsigned long          seq = 0;
+	db_recno_t             id = (db_recno_t)attr_id + 1;
+	DBT                    key = { .data = &id, .size = sizeof(id), 0 };
+	size_t                 sz = size;
+	int                    ret;
+
+	if (cache && (kvs_attr_cache_get(cache, attr_id, buff, size, &seq) ==
+	              size)) {
+		memcpy(num, buff, size);
+		return 0;
+	}
 
-	db_recno_t id = (db_recno_t)attr_id + 1;
-	DBT        key = { .data = &id, .size = sizeof(id), 0 };
-	DBT        item = { 0 };
-	int        ret;
-
-	ret = kvs_get(store, xact, &key, &item, 0);
+	/*
+	 * Retrieve value into local storage so that caller's one is left
+	 * untouched when sizes do not match.
+	 */
+	ret = kvs_get_into(store, xact, &key, buff, &sz);
 	kvs_assert(ret != DB_SECONDARY_BAD);
 
-	if (ret < 0) {
-		errno = -ret;
-		return NULL;
-	}
+	if (ret == -ENOSPC)
+		return -EMSGSIZE;
 
-	if (item.size != size) {
-		errno = EMSGSIZE;
-		return NULL;
-	}
+	if (ret < 0)
+		return ret;
 
-	if (!item.data) {
-		errno = ENODATA;
-		return NULL;
+	if (!sz)
+		return -ENODATA;
+
+	if (sz != size)
+		return -EMSGSIZE;
+
+	memcpy(num, buff, size);
+
+	if (cache)
+		kvs_attr_cache_fill(cache, attr_id, seq, num, size);
+
+	return 0;
+}
+
+int
+kvs_attr_load_data(const struct kvs_store *store,
+                   const struct kvs_xact  *xact,
+                   unsigned int            attr_id,
+                   void                   *data,
+                   size_t                 *size)
+{
+	kvs_assert(attr_id < UINT_MAX);
+	kvs_assert(size);
+
+	struct kvs_attr_cache *cache = kvs_attr_cache_of(store, xact, attr_id);
+	unsigned long          seq = 0;
+	db_recno_t             id = (db_recno_t)attr_id + 1;
+	DBT                    key = { .data = &id, .size = sizeof(id), 0 };
+	size_t                 sz;
+	int                    ret;
+
+	if (cache) {
+		sz = kvs_attr_cache_get(cache, attr_id, data, *size, &seq);
+		if (sz) {
+			*size = sz;
+			return 0;
+		}
 	}
 
-	return item.data;
+	ret = kvs_get_into(store, xact, &key, data, size);
+	kvs_assert(ret != DB_SECONDARY_BAD);
+
+	if (cache && !ret)
+		kvs_attr_cache_fill(cache, attr_id, seq, data, *size);
+
+	return ret;
 }
 
 int
@@ -126,6 +553,10 @@ kvs_attr_store_num(const struct kvs_store *store,
 	DBT        item = { .data = (void *)num, .size = size, 0 };
 	int        ret;
 
+	ret = kvs_attr_cache_hold(store, xact, &attr_id, 1);
+	if (ret)
+		return ret;
+
 	ret = kvs_put(store, xact, &key, &item, 0);
 	kvs_assert(ret != DB_KEYEXIST);
 
@@ -143,12 +574,126 @@ kvs_attr_clear(const struct kvs_store *store,
 	DBT        key = { .data = &id, .size = sizeof(id), 0 };
 	int        ret;
 
+	ret = kvs_attr_cache_hold(store, xact, &attr_id, 1);
+	if (ret)
+		return ret;
+
 	ret = kvs_del(store, xact, &key);
 	kvs_assert(ret != DB_SECONDARY_BAD);
 
 	return ret;
 }
 
+int
+kvs_attr_store_batch(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const unsigned int     *attr_ids,
+                     const struct kvs_chunk *values,
+                     unsigned int            nr)
+{
+	kvs_assert(attr_ids);
+	kvs_assert(values);
+	kvs_assert(nr);
+
+	DBT           bulk;
+	void         *ptr;
+	size_t        sz = 0;
+	unsigned int  a;
+	int           ret;
+
+	for (a = 0; a < nr; a++) {
+		kvs_assert(attr_ids[a] < UINT_MAX);
+		kvs_assert(values[a].data || !values[a].size);
+
+		sz += values[a].size;
+	}
+
+	ret = kvs_attr_cache_hold(store, xact, attr_ids, nr);
+	if (ret)
+		return ret;
+
+	ret = kvs_init_bulk(&bulk, KVS_BULK_RECNO_SIZE(nr, sz), &ptr);
+	if (ret)
+		return ret;
+
+	for (a = 0; a < nr; a++) {
+		DB_MULTIPLE_RECNO_WRITE_NEXT(ptr,
+		                             &bulk,
+		                             (db_recno_t)attr_ids[a] + 1,
+		                             values[a].data,
+		                             values[a].size);
+		kvs_assert(ptr);
+	}
+
+	ret = kvs_put_bulk(store, xact, &bulk);
+	kvs_assert(ret != DB_KEYEXIST);
+
+	kvs_fini_bulk(&bulk);
+
+	return ret;
+}
+
+int
+kvs_attr_clear_batch(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const unsigned int     *attr_ids,
+                     unsigned int            nr)
+{
+	kvs_assert(attr_ids);
+	kvs_assert(nr);
+
+	DBT           bulk;
+	void         *ptr;
+	unsigned int  a;
+	int           ret;
+
+	for (a = 0; a < nr; a++)
+		kvs_assert(attr_ids[a] < UINT_MAX);
+
+	ret = kvs_attr_cache_hold(store, xact, attr_ids, nr);
+	if (ret)
+		return ret;
+
+	ret = kvs_init_bulk(&bulk,
+	                    KVS_BULK_SIZE(nr, nr * sizeof(db_recno_t)),
+	                    &ptr);
+	if (ret)
+		return ret;
+
+	for (a = 0; a < nr; a++) {
+		db_recno_t id = (db_recno_t)attr_ids[a] + 1;
+
+		DB_MULTIPLE_WRITE_NEXT(ptr, &bulk, &id, sizeof(id));
+		kvs_assert(ptr);
+	}
+
+	ret = kvs_del_bulk(store, xact, &bulk);
+	kvs_assert(ret != DB_SECONDARY_BAD);
+
+	kvs_fini_bulk(&bulk);
+
+	return ret;
+}
+
+int
+kvs_attr_open_conf(struct kvs_store            *store,
+                   const struct kvs_depot      *depot,
+                   const struct kvs_xact       *xact,
+                   const char                  *path,
+                   const char                  *name,
+                   const struct kvs_store_conf *conf,
+                   mode_t                       mode)
+{
+	return kvs_open_store(store,
+	                      depot,
+	                      xact,
+	                      path,
+	                      name,
+	                      DB_RECNO,
+	                      conf,
+	                      mode);
+}
+
 int
 kvs_attr_open(struct kvs_store       *store,
               const struct kvs_depot *depot,
@@ -157,12 +702,16 @@ kvs_attr_open(struct kvs_store       *store,
               const char             *name,
               mode_t                  mode)
 {
-	return kvs_open_store(store, depot, xact, path, name, DB_RECNO, mode);
+	return kvs_attr_open_conf(store, depot, xact, path, name, NULL, mode);
 }
 
 int
 kvs_attr_close(const struct kvs_store *store)
 {
+#if defined(CONFIG_KVSTORE_ATTR_CACHE)
+	kvs_attr_disable_cache(store);
+#endif /* defined(CONFIG_KVSTORE_ATTR_CACHE) */
+
 	return kvs_close_store(store);
 }
 
@@ -193,11 +742,28 @@ kvs_attr_load_str(const struct kvs_store  *store,
 {
 	kvs_assert(attr_id < UINT_MAX);
 
-	db_recno_t id = (db_recno_t)attr_id + 1;
-	DBT        key = { .data = &id, .size = sizeof(id), 0 };
-	DBT        item = { 0 };
-	int        ret;
-
+	struct kvs_attr_cache *cache = kvs_attr_cache_of(store, xact, attr_id);
+	unsigned long          seq = 0;
+	db_recno_t             id = (db_recno_t)attr_id + 1;
+	DBT                    key = { .data = &id, .size = sizeof(id), 0 };
+	DBT                    item = { 0 };
+	int                    ret;
+
+#if defined(CONFIG_KVSTORE_ATTR_CACHE)
+	if (cache) {
+		char   str[KVS_ATTR_CACHE_SIZE_MAX];
+		size_t sz;
+
+		sz = kvs_attr_cache_get(cache, attr_id, str, sizeof(str), &seq);
+		if (sz) {
+			ret = kvs_dup_str(string, str, sz);
+			if (ret)
+				return ret;
+
+			return sz;
+		}
+	}
+#endif /* defined(CONFIG_KVSTORE_ATTR_CACHE) */
 
 	ret = kvs_get(store, xact, &key, &item, 0);
 	kvs_assert(ret != DB_SECONDARY_BAD);
@@ -211,6 +777,9 @@ kvs_attr_load_str(const struct kvs_store  *store,
 	if (ret)
 		return ret;
 
+	if (cache)
+		kvs_attr_cache_fill(cache, attr_id, seq, item.data, item.size);
+
 	return item.size;
 }
 
@@ -232,6 +801,10 @@ kvs_attr_store_str(const struct kvs_store *store,
 	if (len >= KVS_STR_MAX)
 		return -ENAMETOOLONG;
 
+	ret = kvs_attr_cache_hold(store, xact, &attr_id, 1);
+	if (ret)
+		return ret;
+
 	ret = kvs_put(store, xact, &key, &item, 0);
 	kvs_assert(ret != DB_KEYEXIST);
 
@@ -284,6 +857,10 @@ kvs_attr_store_strpile(const struct kvs_store  *store,
 	DBT        item = { 0, };
 	int        ret;
 
+	ret = kvs_attr_cache_hold(store, xact, &attr_id, 1);
+	if (ret)
+		return ret;
+
 	ret = kvs_serialize_strpile(pile, &item.data);
 	if (ret < 0)
 		return 0;
@@ -313,15 +890,7 @@ kvs_attr_load_bool(const struct kvs_store *store,
 {
 	kvs_assert(value);
 
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*value));
-	if (!val)
-		return -errno;
-
-	*value = *(bool *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, value, sizeof(*value));
 }
 
 int
@@ -332,15 +901,7 @@ kvs_attr_load_uint64(const struct kvs_store *store,
 {
 	kvs_assert(value);
 
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*value));
-	if (!val)
-		return -errno;
-
-	*value = *(uint64_t *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, value, sizeof(*value));
 }
 
 int
@@ -351,15 +912,7 @@ kvs_attr_load_int64(const struct kvs_store *store,
 {
 	kvs_assert(value);
 
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*value));
-	if (!val)
-		return -errno;
-
-	*value = *(int64_t *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, value, sizeof(*value));
 }
 
 int
@@ -368,15 +921,7 @@ kvs_attr_load_uint32(const struct kvs_store *store,
                      unsigned int            attr_id,
                      uint32_t               *value)
 {
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*value));
-	if (!val)
-		return -errno;
-
-	*value = *(uint32_t *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, value, sizeof(*value));
 }
 
 int
@@ -387,15 +932,7 @@ kvs_attr_load_int32(const struct kvs_store *store,
 {
 	kvs_assert(value);
 
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*value));
-	if (!val)
-		return -errno;
-
-	*value = *(int32_t *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, value, sizeof(*value));
 }
 
 int
@@ -406,15 +943,7 @@ kvs_attr_load_uint16(const struct kvs_store *store,
 {
 	kvs_assert(value);
 
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*value));
-	if (!val)
-		return -errno;
-
-	*value = *(uint16_t *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, value, sizeof(*value));
 }
 
 int
@@ -425,15 +954,7 @@ kvs_attr_load_int16(const struct kvs_store *store,
 {
 	kvs_assert(value);
 
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*value));
-	if (!val)
-		return -errno;
-
-	*value = *(int16_t *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, value, sizeof(*value));
 }
 
 int
@@ -444,15 +965,7 @@ kvs_attr_load_uint8(const struct kvs_store *store,
 {
 	kvs_assert(value);
 
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*value));
-	if (!val)
-		return -errno;
-
-	*value = *(uint8_t *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, value, sizeof(*value));
 }
 
 int
@@ -463,15 +976,7 @@ kvs_attr_load_int8(const struct kvs_store *store,
 {
 	kvs_assert(value);
 
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*value));
-	if (!val)
-		return -errno;
-
-	*value = *(int8_t *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, value, sizeof(*value));
 }
 
 #if defined(CONFIG_KVSTORE_TYPE_INADDR)
@@ -497,15 +1002,7 @@ kvs_attr_load_inaddr(const struct kvs_store *store,
                      unsigned int            attr_id,
                      struct in_addr         *addr)
 {
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*addr));
-	if (!val)
-		return -errno;
-
-	*addr = *(struct in_addr *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, addr, sizeof(*addr));
 }
 
 #endif /* defined(CONFIG_KVSTORE_TYPE_INADDR) */
@@ -533,15 +1030,7 @@ kvs_attr_load_in6addr(const struct kvs_store *store,
                       unsigned int            attr_id,
                       struct in6_addr        *addr)
 {
-	const void *val;
-
-	val = kvs_attr_load_num(store, xact, attr_id, sizeof(*addr));
-	if (!val)
-		return -errno;
-
-	*addr = *(struct in6_addr *)val;
-
-	return 0;
+	return kvs_attr_load_num(store, xact, attr_id, addr, sizeof(*addr));
 }
 
 #endif /* defined(CONFIG_KVSTORE_TYPE_IN6ADDR) */
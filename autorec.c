@@ -58,16 +58,17 @@ kvs_autorec_fill_rec(const DBT        *key,
 	item->size = itm->size;
 }
 
-int
-kvs_autorec_iter_first(const struct kvs_iter *iter,
-                       uint64_t              *id,
-                       struct kvs_chunk      *item)
+static int
+kvs_autorec_iter_goto(const struct kvs_iter *iter,
+                      uint64_t              *id,
+                      struct kvs_chunk      *item,
+                      kvs_iter_goto_fn      *iter_goto)
 {
 	DBT key = { 0, };
 	DBT itm = { 0, };
 	int err;
 
-	err = kvs_iter_goto_first(iter, &key, &itm);
+	err = iter_goto(iter, &key, &itm);
 	if (err)
 		return err;
 
@@ -76,24 +77,222 @@ kvs_autorec_iter_first(const struct kvs_iter *iter,
 	return 0;
 }
 
+int
+kvs_autorec_iter_first(const struct kvs_iter *iter,
+                       uint64_t              *id,
+                       struct kvs_chunk      *item)
+{
+	return kvs_autorec_iter_goto(iter, id, item, kvs_iter_goto_first);
+}
+
 int
 kvs_autorec_iter_next(const struct kvs_iter *iter,
                       uint64_t              *id,
                       struct kvs_chunk      *item)
 {
-	DBT key = { 0, };
+	return kvs_autorec_iter_goto(iter, id, item, kvs_iter_goto_next);
+}
+
+int
+kvs_autorec_iter_last(const struct kvs_iter *iter,
+                      uint64_t              *id,
+                      struct kvs_chunk      *item)
+{
+	return kvs_autorec_iter_goto(iter, id, item, kvs_iter_goto_last);
+}
+
+int
+kvs_autorec_iter_prev(const struct kvs_iter *iter,
+                      uint64_t              *id,
+                      struct kvs_chunk      *item)
+{
+	return kvs_autorec_iter_goto(iter, id, item, kvs_iter_goto_prev);
+}
+
+static void
+kvs_autorec_fill_field_rec(const DBT        *skey,
+                           struct kvs_chunk *field,
+                           const DBT        *pkey,
+                           uint64_t         *id,
+                           const DBT        *itm,
+                           struct kvs_chunk *item)
+{
+	kvs_assert(skey);
+	kvs_assert(skey->data);
+	kvs_assert(skey->size);
+	kvs_assert(field);
+
+	field->size = skey->size;
+	field->data = skey->data;
+
+	kvs_autorec_fill_rec(pkey, id, itm, item);
+}
+
+static int
+kvs_autorec_field_iter_goto(const struct kvs_iter *iter,
+                            DBT                   *skey,
+                            struct kvs_chunk      *field,
+                            uint64_t              *id,
+                            struct kvs_chunk      *item,
+                            kvs_iter_pgoto_fn     *iter_goto)
+{
+	DBT pkey = { 0, };
 	DBT itm = { 0, };
 	int err;
 
-	err = kvs_iter_goto_next(iter, &key, &itm);
+	err = iter_goto(iter, skey, &pkey, &itm);
 	if (err)
 		return err;
 
-	kvs_autorec_fill_rec(&key, id, &itm, item);
+	kvs_autorec_fill_field_rec(skey, field, &pkey, id, &itm, item);
+
+	return 0;
+}
+
+int
+kvs_autorec_field_iter_first(const struct kvs_iter *iter,
+                             struct kvs_chunk      *field,
+                             uint64_t              *id,
+                             struct kvs_chunk      *item)
+{
+	DBT skey = { 0, };
+
+	return kvs_autorec_field_iter_goto(iter,
+	                                   &skey,
+	                                   field,
+	                                   id,
+	                                   item,
+	                                   kvs_iter_pgoto_first);
+}
+
+int
+kvs_autorec_field_iter_next(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            uint64_t              *id,
+                            struct kvs_chunk      *item)
+{
+	DBT skey = { 0, };
+
+	return kvs_autorec_field_iter_goto(iter,
+	                                   &skey,
+	                                   field,
+	                                   id,
+	                                   item,
+	                                   kvs_iter_pgoto_next);
+}
+
+int
+kvs_autorec_field_iter_last(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            uint64_t              *id,
+                            struct kvs_chunk      *item)
+{
+	DBT skey = { 0, };
+
+	return kvs_autorec_field_iter_goto(iter,
+	                                   &skey,
+	                                   field,
+	                                   id,
+	                                   item,
+	                                   kvs_iter_pgoto_last);
+}
+
+int
+kvs_autorec_field_iter_prev(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            uint64_t              *id,
+                            struct kvs_chunk      *item)
+{
+	DBT skey = { 0, };
+
+	return kvs_autorec_field_iter_goto(iter,
+	                                   &skey,
+	                                   field,
+	                                   id,
+	                                   item,
+	                                   kvs_iter_pgoto_prev);
+}
+
+/*
+ * Position iterator onto the first index entry which field is greater than or
+ * equal to the one given in argument. On success, field is updated with the
+ * actual entry field.
+ */
+int
+kvs_autorec_field_iter_seek(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            uint64_t              *id,
+                            struct kvs_chunk      *item)
+{
+	kvs_assert(field);
+	kvs_assert(field->data);
+	kvs_assert(field->size);
+
+	DBT skey = KVS_CHUNK_INIT_DBT(field);
+
+	return kvs_autorec_field_iter_goto(iter,
+	                                   &skey,
+	                                   field,
+	                                   id,
+	                                   item,
+	                                   kvs_iter_pgoto_seek);
+}
+
+static int
+kvs_autorec_iter_byfield_goto(const struct kvs_iter *iter,
+                              uint64_t              *id,
+                              struct kvs_chunk      *item,
+                              kvs_iter_dups_fn      *iter_goto)
+{
+	kvs_assert(id);
+
+	DBT pkey = { 0, };
+	DBT itm = { 0, };
+	int err;
+
+	err = iter_goto(iter, &pkey, item ? &itm : NULL);
+	if (err)
+		return err;
+
+	if (!item) {
+		*id = kvs_autorec_key_to_id(&pkey);
+
+		return 0;
+	}
+
+	kvs_autorec_fill_rec(&pkey, id, &itm, item);
 
 	return 0;
 }
 
+/*
+ * Walk primary records matching the field given at iterator initialization
+ * time (see kvs_autorec_init_byfield_iter()), sorted by record identifier.
+ * When item is NULL, only identifiers are returned, sparing primary store
+ * lookups.
+ */
+int
+kvs_autorec_iter_byfield_first(const struct kvs_iter *iter,
+                               uint64_t              *id,
+                               struct kvs_chunk      *item)
+{
+	return kvs_autorec_iter_byfield_goto(iter,
+	                                     id,
+	                                     item,
+	                                     kvs_iter_dups_first);
+}
+
+int
+kvs_autorec_iter_byfield_next(const struct kvs_iter *iter,
+                              uint64_t              *id,
+                              struct kvs_chunk      *item)
+{
+	return kvs_autorec_iter_byfield_goto(iter,
+	                                     id,
+	                                     item,
+	                                     kvs_iter_dups_next);
+}
+
 int
 kvs_autorec_init_iter(const struct kvs_store *store,
                       const struct kvs_xact  *xact,
@@ -102,6 +301,55 @@ kvs_autorec_init_iter(const struct kvs_store *store,
 	return kvs_init_iter(store, xact, iter);
 }
 
+int
+kvs_autorec_init_bulk_iter(const struct kvs_store *store,
+                           const struct kvs_xact  *xact,
+                           struct kvs_iter        *iter,
+                           size_t                  size)
+{
+	return kvs_init_bulk_iter(store, xact, iter, size);
+}
+
+int
+kvs_autorec_init_field_iter(const struct kvs_store *index,
+                            const struct kvs_xact  *xact,
+                            struct kvs_iter        *iter,
+                            const struct kvs_range *range)
+{
+	kvs_assert(index);
+	kvs_assert(index->db);
+	kvs_assert(index->db->app_private);
+
+	return kvs_init_range_iter(index, xact, iter, range);
+}
+
+/*
+ * Initialize an iterator over all records which field, as indexed by the given
+ * duplicate-sorted index (see KVS_STORE_DUPSORT), matches the one given in
+ * argument. Matching identifiers are fetched in bulk using buffers of size
+ * bytes.
+ * field is referenced, not copied: it must remain valid until the iterator is
+ * finalized.
+ */
+int
+kvs_autorec_init_byfield_iter(const struct kvs_store *index,
+                              const struct kvs_xact  *xact,
+                              struct kvs_iter        *iter,
+                              const struct kvs_chunk *field,
+                              size_t                  size)
+{
+	kvs_assert(index);
+	kvs_assert(index->db);
+	kvs_assert(index->db->app_private);
+	kvs_assert(field);
+	kvs_assert(field->data);
+	kvs_assert(field->size);
+
+	const DBT skey = KVS_CHUNK_INIT_DBT(field);
+
+	return kvs_init_dups_iter(index, xact, iter, &skey, size);
+}
+
 int
 kvs_autorec_fini_iter(const struct kvs_iter *iter)
 {
@@ -138,6 +386,25 @@ kvs_autorec_get_byid(const struct kvs_store *store,
 	return 0;
 }
 
+int
+kvs_autorec_load_byid(const struct kvs_store *store,
+                      const struct kvs_xact  *xact,
+                      uint64_t                id,
+                      void                   *data,
+                      size_t                 *size)
+{
+	kvs_assert(kvs_autorec_id_isok(id));
+
+	DB_HEAP_RID rid = KVS_AUTOREC_INIT_RID(id);
+	DBT         key = KVS_AUTOREC_INIT_KEY(&rid);
+	int         ret;
+
+	ret = kvs_get_into(store, xact, &key, data, size);
+	kvs_assert(ret != DB_SECONDARY_BAD);
+
+	return ret;
+}
+
 int
 kvs_autorec_get_byfield(const struct kvs_store *index,
                         const struct kvs_xact  *xact,
@@ -192,6 +459,39 @@ kvs_autorec_add(const struct kvs_store *store,
 	return 0;
 }
 
+int
+kvs_autorec_add_batch(const struct kvs_store *store,
+                      const struct kvs_xact  *xact,
+                      uint64_t               *ids,
+                      const struct kvs_chunk *items,
+                      unsigned int            nr)
+{
+	kvs_assert(ids);
+	kvs_assert(items);
+	kvs_assert(nr);
+
+	unsigned int r;
+
+	/*
+	 * BDB cannot combine DB_APPEND with bulk DB_MULTIPLE_KEY puts, and
+	 * heap record IDs are not allocated contiguously anyway: append items
+	 * one by one and report allocated IDs into the ids array.
+	 */
+	for (r = 0; r < nr; r++) {
+		DBT key = { 0, };
+		DBT itm = KVS_CHUNK_INIT_DBT(&items[r]);
+		int ret;
+
+		ret = kvs_put(store, xact, &key, &itm, DB_APPEND);
+		if (ret)
+			return ret;
+
+		ids[r] = kvs_autorec_key_to_id(&key);
+	}
+
+	return 0;
+}
+
 int
 kvs_autorec_update(const struct kvs_store *store,
                    const struct kvs_xact  *xact,
@@ -221,6 +521,42 @@ kvs_autorec_del_byid(const struct kvs_store *store,
 	return kvs_del(store, xact, &key);
 }
 
+int
+kvs_autorec_del_batch(const struct kvs_store *store,
+                      const struct kvs_xact  *xact,
+                      const uint64_t         *ids,
+                      unsigned int            nr)
+{
+	kvs_assert(ids);
+	kvs_assert(nr);
+
+	DBT           bulk;
+	void         *ptr;
+	unsigned int  r;
+	int           ret;
+
+	ret = kvs_init_bulk(&bulk,
+	                    KVS_BULK_SIZE(nr, nr * DB_HEAP_RID_SZ),
+	                    &ptr);
+	if (ret)
+		return ret;
+
+	for (r = 0; r < nr; r++) {
+		kvs_assert(kvs_autorec_id_isok(ids[r]));
+
+		DB_HEAP_RID rid = KVS_AUTOREC_INIT_RID(ids[r]);
+
+		DB_MULTIPLE_WRITE_NEXT(ptr, &bulk, &rid, DB_HEAP_RID_SZ);
+		kvs_assert(ptr);
+	}
+
+	ret = kvs_del_bulk(store, xact, &bulk);
+
+	kvs_fini_bulk(&bulk);
+
+	return ret;
+}
+
 int
 kvs_autorec_del_byfield(const struct kvs_store *index,
                         const struct kvs_xact  *xact,
@@ -236,6 +572,25 @@ kvs_autorec_del_byfield(const struct kvs_store *index,
 	return kvs_del(index, xact, &key);
 }
 
+int
+kvs_autorec_open_conf(struct kvs_store            *store,
+                      const struct kvs_depot      *depot,
+                      const struct kvs_xact       *xact,
+                      const char                  *path,
+                      const struct kvs_store_conf *conf,
+                      mode_t                       mode)
+{
+	/* Heap databases don't support named sub-databases. */
+	return kvs_open_store(store,
+	                      depot,
+	                      xact,
+	                      path,
+	                      NULL,
+	                      DB_HEAP,
+	                      conf,
+	                      mode);
+}
+
 int
 kvs_autorec_open(struct kvs_store       *store,
                  const struct kvs_depot *depot,
@@ -243,8 +598,7 @@ kvs_autorec_open(struct kvs_store       *store,
                  const char             *path,
                  mode_t                  mode)
 {
-	/* Heap databases don't support named sub-databases. */
-	return kvs_open_store(store, depot, xact, path, NULL, DB_HEAP, mode);
+	return kvs_autorec_open_conf(store, depot, xact, path, NULL, mode);
 }
 
 int
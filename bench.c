@@ -0,0 +1,3535 @@
+#include <kvstore/config.h>
+#include <utils/cdefs.h>
+#include <limits.h>
+#include <kvstore/store.h>
+#include <kvstore/strrec.h>
+#if defined(CONFIG_KVSTORE_ATTR)
+#include <kvstore/attr.h>
+#endif
+#if defined(CONFIG_KVSTORE_AUTOREC)
+#include <kvstore/autorec.h>
+#endif
+#if defined(CONFIG_KVSTORE_TABLE)
+#include <kvstore/table.h>
+#endif
+#if defined(CONFIG_KVSTORE_FILE)
+#include <kvstore/file.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define KVS_BENCH_PATH     "benchdb"
+#define KVS_BENCH_NR       (100000UL)
+#define KVS_BENCH_SIZE     (64U)
+#define KVS_BENCH_XACT_NR  (1000UL)
+#define KVS_BENCH_LOG_SIZE (4U << 20)
+#define KVS_BENCH_THREAD_NR (8U)
+
+enum kvs_bench_op {
+	KVS_BENCH_LOAD,
+	KVS_BENCH_GET,
+	KVS_BENCH_PUT,
+	KVS_BENCH_SCAN,
+	KVS_BENCH_MIXED,
+	KVS_BENCH_DEL,
+	KVS_BENCH_OP_NR
+};
+
+struct kvs_bench_commit_mode;
+
+struct kvs_bench_conf {
+	const char                         *path;
+	unsigned long                       nr;
+	size_t                              size;
+	size_t                              key_size;
+	size_t                              bulk;
+	size_t                              cache;
+	unsigned int                        threads;
+	unsigned int                        ratio;
+	const struct kvs_bench_commit_mode *mode;
+	unsigned int                        types;
+	unsigned int                        ops;
+	bool                                json;
+};
+
+struct kvs_bench_workload {
+	const char  *name;
+	int        (*run)(const struct kvs_bench_conf *conf,
+	                  const struct kvs_depot      *depot);
+};
+
+static const char *kvs_bench_argv0;
+
+static void
+kvs_bench_err(const char *what, int err)
+{
+	fprintf(stderr,
+	        "%s: failed to %s: %s (%d).\n",
+	        kvs_bench_argv0,
+	        what,
+	        kvs_strerror(err),
+	        err);
+}
+
+/* Direct libdb calls return BDB error codes or positive errno values. */
+static int
+kvs_bench_err_from_bdb(int err)
+{
+	return (err > 0) ? -err : err;
+}
+
+static double
+kvs_bench_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+}
+
+static void
+kvs_bench_report(const char    *workload,
+                 const char    *mode,
+                 unsigned long  nr,
+                 double         secs)
+{
+	printf("%-8s %-8s records=%lu secs=%.6f rate=%.0f rec/s\n",
+	       workload,
+	       mode,
+	       nr,
+	       secs,
+	       (double)nr / secs);
+}
+
+#define KVS_BENCH_KEY_MAX (64U)
+
+typedef size_t (kvs_bench_key_fn)(char *key, unsigned long rec);
+
+static size_t
+kvs_bench_rec_key(char *key, unsigned long rec)
+{
+	return (size_t)sprintf(key, "rec%012lu", rec);
+}
+
+/*
+ * Long hierarchical keys sharing most of their prefix with their neighbours.
+ */
+static size_t
+kvs_bench_path_key(char *key, unsigned long rec)
+{
+	return (size_t)sprintf(key,
+	                       "/platform/soc/bus%03lu/device%03lu/attribute%03lu",
+	                       (rec / 1000000UL) % 1000UL,
+	                       (rec / 1000UL) % 1000UL,
+	                       rec % 1000UL);
+}
+
+static int
+kvs_bench_fill_strrec(const struct kvs_bench_conf *conf,
+                      const struct kvs_depot      *depot,
+                      const struct kvs_store      *store,
+                      kvs_bench_key_fn            *make_key)
+{
+	char             *data;
+	char              key[KVS_BENCH_KEY_MAX];
+	struct kvs_chunk  id = { .data = key };
+	struct kvs_chunk  item;
+	struct kvs_xact   xact;
+	unsigned long     r = 0;
+	int               err = 0;
+
+	data = malloc(conf->size);
+	if (!data)
+		return -ENOMEM;
+	memset(data, 0xa5, conf->size);
+
+	item.data = data;
+	item.size = conf->size;
+
+	while (!err && (r < conf->nr)) {
+		unsigned long n;
+
+		err = kvs_begin_xact(depot, NULL, &xact, 0);
+		if (err)
+			break;
+
+		for (n = 0; !err && (n < KVS_BENCH_XACT_NR) && (r < conf->nr);
+		     n++, r++) {
+			id.size = make_key(key, r);
+			err = kvs_strrec_put(store, &xact, &id, &item);
+		}
+
+		err = kvs_end_xact(&xact, err);
+	}
+
+	free(data);
+
+	return err;
+}
+
+static int
+kvs_bench_fill_strrec_batch(const struct kvs_bench_conf *conf,
+                            const struct kvs_depot      *depot,
+                            const struct kvs_store      *store)
+{
+	char             *data;
+	char             (*keys)[KVS_BENCH_KEY_MAX];
+	struct kvs_chunk *ids;
+	struct kvs_chunk *items;
+	struct kvs_xact   xact;
+	unsigned long     r = 0;
+	int               err = -ENOMEM;
+
+	data = malloc(conf->size);
+	keys = malloc(KVS_BENCH_XACT_NR * sizeof(keys[0]));
+	ids = malloc(KVS_BENCH_XACT_NR * sizeof(ids[0]));
+	items = malloc(KVS_BENCH_XACT_NR * sizeof(items[0]));
+	if (!data || !keys || !ids || !items)
+		goto free;
+
+	memset(data, 0xa5, conf->size);
+
+	err = 0;
+	while (!err && (r < conf->nr)) {
+		unsigned long n;
+
+		for (n = 0; (n < KVS_BENCH_XACT_NR) && (r < conf->nr);
+		     n++, r++) {
+			ids[n].data = keys[n];
+			ids[n].size = kvs_bench_rec_key(keys[n], r);
+			items[n].data = data;
+			items[n].size = conf->size;
+		}
+
+		err = kvs_begin_xact(depot, NULL, &xact, 0);
+		if (err)
+			break;
+
+		err = kvs_strrec_put_batch(store, &xact, ids, items, n);
+
+		err = kvs_end_xact(&xact, err);
+	}
+
+free:
+	free(items);
+	free(ids);
+	free(keys);
+	free(data);
+
+	return err;
+}
+
+static int
+kvs_bench_scan_strrec(const struct kvs_depot *depot,
+                      const struct kvs_store *store,
+                      unsigned int            flags,
+                      size_t                  bulk,
+                      unsigned long          *count)
+{
+	struct kvs_xact  xact;
+	struct kvs_iter  iter;
+	struct kvs_chunk id;
+	struct kvs_chunk item;
+	unsigned long    nr = 0;
+	int              err;
+
+	err = kvs_begin_xact(depot, NULL, &xact, flags);
+	if (err)
+		return err;
+
+	if (bulk)
+		err = kvs_strrec_init_bulk_iter(store, &xact, &iter, bulk);
+	else
+		err = kvs_strrec_init_iter(store, &xact, &iter);
+	if (err)
+		goto end;
+
+	for (err = kvs_strrec_iter_first(&iter, &id, &item);
+	     !err;
+	     err = kvs_strrec_iter_next(&iter, &id, &item))
+		nr++;
+
+	if (err == DB_NOTFOUND)
+		err = 0;
+
+	kvs_strrec_fini_iter(&iter);
+
+end:
+	*count = nr;
+
+	return kvs_end_xact(&xact, err);
+}
+
+static int
+kvs_bench_run_scan(const struct kvs_bench_conf *conf,
+                   const struct kvs_depot      *depot)
+{
+	struct kvs_store store;
+	unsigned long    nr;
+	double           start;
+	int              err;
+
+	err = kvs_strrec_open(&store,
+	                      depot,
+	                      NULL,
+	                      "scan.db",
+	                      NULL,
+	                      S_IRWXU);
+	if (err) {
+		kvs_bench_err("open scan store", err);
+		goto close;
+	}
+
+	err = kvs_bench_fill_strrec(conf, depot, &store, kvs_bench_rec_key);
+	if (err) {
+		kvs_bench_err("fill scan store", err);
+		goto close;
+	}
+
+	start = kvs_bench_now();
+	err = kvs_bench_scan_strrec(depot, &store, 0, 0, &nr);
+	if (err) {
+		kvs_bench_err("scan store", err);
+		goto close;
+	}
+	kvs_bench_report("scan", "cursor", nr, kvs_bench_now() - start);
+
+	start = kvs_bench_now();
+	err = kvs_bench_scan_strrec(depot, &store, 0, conf->bulk, &nr);
+	if (err) {
+		kvs_bench_err("bulk scan store", err);
+		goto close;
+	}
+	kvs_bench_report("scan", "bulk", nr, kvs_bench_now() - start);
+
+close:
+	kvs_strrec_close(&store);
+
+	return err;
+}
+
+static int
+kvs_bench_run_put(const struct kvs_bench_conf *conf,
+                  const struct kvs_depot      *depot)
+{
+	struct kvs_store single;
+	struct kvs_store batch;
+	double           start;
+	int              err;
+
+	err = kvs_strrec_open(&single,
+	                      depot,
+	                      NULL,
+	                      "put-single.db",
+	                      NULL,
+	                      S_IRWXU);
+	if (err) {
+		kvs_bench_err("open single put store", err);
+		goto close_single;
+	}
+
+	err = kvs_strrec_open(&batch,
+	                      depot,
+	                      NULL,
+	                      "put-batch.db",
+	                      NULL,
+	                      S_IRWXU);
+	if (err) {
+		kvs_bench_err("open batch put store", err);
+		goto close_batch;
+	}
+
+	start = kvs_bench_now();
+	err = kvs_bench_fill_strrec(conf,
+	                            depot,
+	                            &single,
+	                            kvs_bench_rec_key);
+	if (err) {
+		kvs_bench_err("put records", err);
+		goto close_batch;
+	}
+	kvs_bench_report("put", "single", conf->nr, kvs_bench_now() - start);
+
+	start = kvs_bench_now();
+	err = kvs_bench_fill_strrec_batch(conf, depot, &batch);
+	if (err) {
+		kvs_bench_err("put record batches", err);
+		goto close_batch;
+	}
+	kvs_bench_report("put", "batch", conf->nr, kvs_bench_now() - start);
+
+close_batch:
+	kvs_strrec_close(&batch);
+close_single:
+	kvs_strrec_close(&single);
+
+	return err;
+}
+
+/*
+ * Perform conf->nr lookups of existing records in a scattered order and return
+ * the mean lookup latency in seconds.
+ */
+static int
+kvs_bench_lookup_strrec(const struct kvs_bench_conf *conf,
+                        const struct kvs_depot      *depot,
+                        const struct kvs_store      *store,
+                        kvs_bench_key_fn            *make_key,
+                        double                      *latency)
+{
+	char             key[KVS_BENCH_KEY_MAX];
+	struct kvs_chunk id = { .data = key };
+	struct kvs_chunk item;
+	struct kvs_xact  xact;
+	unsigned long    n;
+	double           start;
+	int              err;
+
+	err = kvs_begin_xact(depot, NULL, &xact, 0);
+	if (err)
+		return err;
+
+	start = kvs_bench_now();
+	for (n = 0; !err && (n < conf->nr); n++) {
+		/* Knuth's multiplicative hash to scatter accesses. */
+		id.size = make_key(key, (n * 2654435761UL) % conf->nr);
+		err = kvs_strrec_get_byid(store, &xact, &id, &item);
+	}
+	*latency = (kvs_bench_now() - start) / (double)conf->nr;
+
+	return kvs_end_xact(&xact, err);
+}
+
+static int
+kvs_bench_clear_cache_stats(const struct kvs_depot *depot)
+{
+	DB_MPOOL_STAT   *stat;
+	DB_MPOOL_FSTAT **fstats;
+	int              err;
+
+	err = depot->env->memp_stat(depot->env, &stat, &fstats, DB_STAT_CLEAR);
+	if (err)
+		return kvs_bench_err_from_bdb(err);
+
+	free(fstats);
+	free(stat);
+
+	return 0;
+}
+
+static int
+kvs_bench_get_cache_ratio(const struct kvs_depot *depot,
+                          const char             *file,
+                          double                 *ratio)
+{
+	DB_MPOOL_STAT   *stat;
+	DB_MPOOL_FSTAT **fstats;
+	unsigned int     f;
+	int              err;
+
+	err = depot->env->memp_stat(depot->env, &stat, &fstats, 0);
+	if (err)
+		return kvs_bench_err_from_bdb(err);
+
+	*ratio = 0;
+	for (f = 0; fstats[f]; f++) {
+		uintmax_t total = fstats[f]->st_cache_hit +
+		                  fstats[f]->st_cache_miss;
+
+		if (strcmp(fstats[f]->file_name, file))
+			continue;
+
+		if (total)
+			*ratio = (double)fstats[f]->st_cache_hit /
+			         (double)total;
+		break;
+	}
+
+	free(fstats);
+	free(stat);
+
+	return 0;
+}
+
+static int
+kvs_bench_get_size(const struct kvs_store *store, unsigned long long *size)
+{
+	struct kvs_store_stats stats;
+	int                    err;
+
+	err = kvs_get_store_stats(store, NULL, &stats, KVS_STATS_FAST);
+	if (err)
+		return err;
+
+	*size = (unsigned long long)stats.page_nr * stats.page_size;
+
+	return 0;
+}
+
+static int
+kvs_bench_run_compress_store(const struct kvs_bench_conf *conf,
+                             const struct kvs_depot      *depot,
+                             const char                  *mode,
+                             const char                  *file,
+                             const struct kvs_store_conf *sconf)
+{
+	struct kvs_store   store;
+	double             start;
+	double             fill;
+	double             latency;
+	double             ratio;
+	unsigned long long size;
+	int                err;
+
+	err = kvs_strrec_open_conf(&store,
+	                           depot,
+	                           NULL,
+	                           file,
+	                           NULL,
+	                           sconf,
+	                           S_IRWXU);
+	if (err) {
+		kvs_bench_err("open compression store", err);
+		goto close;
+	}
+
+	start = kvs_bench_now();
+	err = kvs_bench_fill_strrec(conf, depot, &store, kvs_bench_path_key);
+	if (err) {
+		kvs_bench_err("fill compression store", err);
+		goto close;
+	}
+	fill = kvs_bench_now() - start;
+
+	err = kvs_bench_get_size(&store, &size);
+	if (err) {
+		kvs_bench_err("get compression store size", err);
+		goto close;
+	}
+
+	err = kvs_bench_clear_cache_stats(depot);
+	if (err) {
+		kvs_bench_err("clear cache statistics", err);
+		goto close;
+	}
+
+	err = kvs_bench_lookup_strrec(conf,
+	                              depot,
+	                              &store,
+	                              kvs_bench_path_key,
+	                              &latency);
+	if (err) {
+		kvs_bench_err("lookup compression store", err);
+		goto close;
+	}
+
+	err = kvs_bench_get_cache_ratio(depot, file, &ratio);
+	if (err) {
+		kvs_bench_err("get cache statistics", err);
+		goto close;
+	}
+
+	kvs_bench_report("compress", mode, conf->nr, fill);
+	printf("%-8s %-8s size=%llu hit=%.2f%% lookup=%.3f us\n",
+	       "compress",
+	       mode,
+	       size,
+	       ratio * 100.0,
+	       latency * 1e6);
+
+close:
+	kvs_strrec_close(&store);
+
+	return err;
+}
+
+static int
+kvs_bench_run_compress(const struct kvs_bench_conf *conf,
+                       const struct kvs_depot      *depot)
+{
+	static const struct kvs_store_conf prefix = {
+		.flags = KVS_STORE_COMPRESS
+	};
+	int                                err;
+
+	err = kvs_bench_run_compress_store(conf,
+	                                   depot,
+	                                   "plain",
+	                                   "compress-plain.db",
+	                                   NULL);
+	if (err)
+		return err;
+
+	return kvs_bench_run_compress_store(conf,
+	                                    depot,
+	                                    "prefix",
+	                                    "compress-prefix.db",
+	                                    &prefix);
+}
+
+struct kvs_bench_commit_mode {
+	const char   *name;
+	unsigned int  durability;
+	bool          group;
+};
+
+static const struct kvs_bench_commit_mode kvs_bench_commit_modes[] = {
+	{ .name = "sync",         .durability = KVS_XACT_SYNC },
+	{ .name = "write-nosync", .durability = KVS_XACT_WRITE_NOSYNC },
+	{ .name = "nosync",       .durability = KVS_XACT_NOSYNC },
+	{ .name = "group",        .durability = KVS_XACT_SYNC,
+	                          .group = true }
+};
+
+#define KVS_BENCH_COMMIT_MODE_NR \
+	(sizeof(kvs_bench_commit_modes) / sizeof(kvs_bench_commit_modes[0]))
+
+struct kvs_bench_committer {
+	pthread_t               thread;
+	unsigned int            id;
+	unsigned long           nr;
+	const struct kvs_depot *depot;
+	const struct kvs_store *store;
+	int                     err;
+};
+
+struct kvs_bench_commit_rec {
+	const struct kvs_store *store;
+	struct kvs_chunk        id;
+};
+
+static int
+kvs_bench_commit_rec(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_commit_rec *rec = data;
+
+	return kvs_strrec_put(rec->store, xact, &rec->id, &rec->id);
+}
+
+/* Perform one single-record transaction per commit. */
+static void *
+kvs_bench_commit(void *data)
+{
+	struct kvs_bench_committer *cmt = data;
+	char                        key[KVS_BENCH_KEY_MAX];
+	struct kvs_bench_commit_rec rec = {
+		.store = cmt->store,
+		.id    = { .data = key }
+	};
+	unsigned long               n;
+
+	for (n = 0; n < cmt->nr; n++) {
+		int err;
+
+		rec.id.size = sprintf(key, "thr%03u-%012lu", cmt->id, n);
+
+		err = kvs_run_xact(cmt->depot,
+		                   NULL,
+		                   0,
+		                   kvs_bench_commit_rec,
+		                   &rec,
+		                   NULL);
+
+		if (err) {
+			cmt->err = err;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static int
+kvs_bench_run_commit_threads(const struct kvs_bench_conf *conf,
+                             const struct kvs_depot      *depot,
+                             const struct kvs_store      *store,
+                             unsigned int                 nr,
+                             double                      *secs)
+{
+	struct kvs_bench_committer *cmts;
+	unsigned int                t;
+	double                      start;
+	int                         err = 0;
+
+	cmts = calloc(nr, sizeof(cmts[0]));
+	if (!cmts)
+		return -ENOMEM;
+
+	start = kvs_bench_now();
+
+	for (t = 0; t < nr; t++) {
+		cmts[t].id = t;
+		cmts[t].nr = conf->nr / nr;
+		cmts[t].depot = depot;
+		cmts[t].store = store;
+
+		err = -pthread_create(&cmts[t].thread,
+		                      NULL,
+		                      kvs_bench_commit,
+		                      &cmts[t]);
+		if (err)
+			break;
+	}
+
+	nr = t;
+	for (t = 0; t < nr; t++) {
+		pthread_join(cmts[t].thread, NULL);
+		if (!err)
+			err = cmts[t].err;
+	}
+
+	*secs = kvs_bench_now() - start;
+
+	free(cmts);
+
+	return err;
+}
+
+/*
+ * Measure commit throughput against the number of committing threads for each
+ * durability mode. Each mode runs into its own depot since group commit is a
+ * depot wide setting.
+ */
+static int
+kvs_bench_run_commit_mode(const struct kvs_bench_conf        *conf,
+                          const struct kvs_bench_commit_mode *mode)
+{
+	struct kvs_depot_conf dconf = {
+		.cache_size   = conf->cache,
+		.durability   = mode->durability,
+		.group_commit = mode->group
+	};
+	struct kvs_depot      depot;
+	struct kvs_store      store;
+	char                 *path;
+	unsigned int          nr;
+	int                   err;
+
+	if (asprintf(&path, "%s/commit-%s", conf->path, mode->name) < 0)
+		return -ENOMEM;
+
+	err = kvs_open_depot_conf(&depot,
+	                          path,
+	                          KVS_BENCH_LOG_SIZE,
+	                          &dconf,
+	                          KVS_DEPOT_THREAD,
+	                          S_IRWXU);
+	free(path);
+	if (err) {
+		kvs_bench_err("open commit depot", err);
+		return err;
+	}
+
+	err = kvs_strrec_open(&store,
+	                      &depot,
+	                      NULL,
+	                      "commit.db",
+	                      NULL,
+	                      S_IRWXU);
+	if (err) {
+		kvs_bench_err("open commit store", err);
+		goto close;
+	}
+
+	for (nr = 1; nr <= conf->threads; nr *= 2) {
+		struct kvs_xact_stats before;
+		struct kvs_xact_stats after;
+		double                secs;
+
+		kvs_get_xact_stats(&depot, &before);
+
+		err = kvs_bench_run_commit_threads(conf, &depot, &store, nr, &secs);
+		if (err) {
+			kvs_bench_err("commit records", err);
+			break;
+		}
+
+		kvs_get_xact_stats(&depot, &after);
+
+		printf("%-8s %-12s threads=%u commits=%lu secs=%.6f "
+		       "rate=%.0f commit/s retries=%lu\n",
+		       "commit",
+		       mode->name,
+		       nr,
+		       (conf->nr / nr) * nr,
+		       secs,
+		       (double)((conf->nr / nr) * nr) / secs,
+		       after.retry_nr - before.retry_nr);
+	}
+
+close:
+	kvs_strrec_close(&store);
+
+	if (kvs_close_depot(&depot) && !err)
+		err = -EIO;
+
+	return err;
+}
+
+static int
+kvs_bench_run_commit(const struct kvs_bench_conf *conf,
+                     const struct kvs_depot      *depot)
+{
+	unsigned int m;
+	int          err;
+
+	/* Each durability mode runs into a depot of its own. */
+	(void)depot;
+
+	for (m = 0; m < KVS_BENCH_COMMIT_MODE_NR; m++) {
+		err = kvs_bench_run_commit_mode(conf,
+		                                &kvs_bench_commit_modes[m]);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+#define KVS_BENCH_ISOL_SECS (3U)
+
+struct kvs_bench_isol_mode {
+	const char   *name;
+	unsigned int  flags;
+};
+
+struct kvs_bench_isol_thread {
+	pthread_t                    thread;
+	unsigned int                 id;
+	bool                         reader;
+	const struct kvs_bench_conf *conf;
+	const struct kvs_depot      *depot;
+	const struct kvs_store      *store;
+	unsigned int                 flags;
+	const bool                  *stop;
+	unsigned long                nr;
+	unsigned long                conflicts;
+	int                          err;
+};
+
+struct kvs_bench_isol_rec {
+	const struct kvs_store *store;
+	struct kvs_chunk        id;
+	struct kvs_chunk        item;
+};
+
+static bool
+kvs_bench_isol_conflict(int err)
+{
+	return (err == DB_LOCK_DEADLOCK) || (err == DB_LOCK_NOTGRANTED);
+}
+
+static int
+kvs_bench_isol_update(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_isol_rec *rec = data;
+
+	return kvs_strrec_put(rec->store, xact, &rec->id, &rec->item);
+}
+
+/* Keep rewriting randomly selected records, one per transaction. */
+static void
+kvs_bench_isol_write(struct kvs_bench_isol_thread *thr)
+{
+	char                      key[KVS_BENCH_KEY_MAX];
+	struct kvs_bench_isol_rec rec = {
+		.store = thr->store,
+		.id    = { .data = key }
+	};
+	unsigned int              seed = thr->id;
+	char                     *item;
+
+	item = malloc(thr->conf->size);
+	if (!item) {
+		thr->err = -ENOMEM;
+		return;
+	}
+
+	rec.item.data = item;
+	rec.item.size = thr->conf->size;
+
+	while (!__atomic_load_n(thr->stop, __ATOMIC_RELAXED)) {
+		unsigned long r = (unsigned long)rand_r(&seed) % thr->conf->nr;
+		int           err;
+
+		memset(item, (int)r, thr->conf->size);
+		rec.id.size = kvs_bench_rec_key(key, r);
+
+		err = kvs_run_xact(thr->depot,
+		                   NULL,
+		                   0,
+		                   kvs_bench_isol_update,
+		                   &rec,
+		                   NULL);
+		if (!err)
+			thr->nr++;
+		else if (kvs_bench_isol_conflict(err))
+			thr->conflicts++;
+		else {
+			thr->err = err;
+			break;
+		}
+	}
+
+	free(item);
+}
+
+/* Keep scanning the whole store using the isolation level under test. */
+static void
+kvs_bench_isol_read(struct kvs_bench_isol_thread *thr)
+{
+	while (!__atomic_load_n(thr->stop, __ATOMIC_RELAXED)) {
+		unsigned long nr;
+		int           err;
+
+		err = kvs_bench_scan_strrec(thr->depot,
+		                            thr->store,
+		                            thr->flags,
+		                            0,
+		                            &nr);
+		if (!err)
+			thr->nr++;
+		else if (kvs_bench_isol_conflict(err))
+			thr->conflicts++;
+		else {
+			thr->err = err;
+			break;
+		}
+	}
+}
+
+static void *
+kvs_bench_isol(void *data)
+{
+	struct kvs_bench_isol_thread *thr = data;
+
+	if (thr->reader)
+		kvs_bench_isol_read(thr);
+	else
+		kvs_bench_isol_write(thr);
+
+	return NULL;
+}
+
+/*
+ * Run as many reader threads as writer threads for KVS_BENCH_ISOL_SECS seconds
+ * and report scan and update throughputs.
+ */
+static int
+kvs_bench_run_isol_mode(const struct kvs_bench_conf      *conf,
+                        const struct kvs_depot           *depot,
+                        const struct kvs_store           *store,
+                        const struct kvs_bench_isol_mode *mode)
+{
+	unsigned int                  nr = (conf->threads > 1) ?
+	                                   conf->threads / 2 : 1;
+	struct kvs_bench_isol_thread *thrs;
+	bool                          stop = false;
+	unsigned long                 scans = 0;
+	unsigned long                 updates = 0;
+	unsigned long                 conflicts = 0;
+	unsigned int                  cnt;
+	unsigned int                  t;
+	double                        start;
+	double                        secs;
+	int                           err = 0;
+
+	thrs = calloc(2 * nr, sizeof(thrs[0]));
+	if (!thrs)
+		return -ENOMEM;
+
+	start = kvs_bench_now();
+
+	for (t = 0; t < (2 * nr); t++) {
+		thrs[t].id = t;
+		thrs[t].reader = (t % 2) == 0;
+		thrs[t].conf = conf;
+		thrs[t].depot = depot;
+		thrs[t].store = store;
+		thrs[t].flags = mode->flags;
+		thrs[t].stop = &stop;
+
+		err = -pthread_create(&thrs[t].thread,
+		                      NULL,
+		                      kvs_bench_isol,
+		                      &thrs[t]);
+		if (err)
+			break;
+	}
+
+	if (!err)
+		sleep(KVS_BENCH_ISOL_SECS);
+
+	__atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+
+	cnt = t;
+	for (t = 0; t < cnt; t++) {
+		pthread_join(thrs[t].thread, NULL);
+		if (!err)
+			err = thrs[t].err;
+
+		if (thrs[t].reader)
+			scans += thrs[t].nr;
+		else
+			updates += thrs[t].nr;
+		conflicts += thrs[t].conflicts;
+	}
+
+	secs = kvs_bench_now() - start;
+
+	free(thrs);
+
+	if (err)
+		return err;
+
+	printf("%-8s %-16s readers=%u writers=%u secs=%.6f "
+	       "scan_rate=%.1f scan/s update_rate=%.0f update/s "
+	       "conflicts=%lu\n",
+	       "isol",
+	       mode->name,
+	       nr,
+	       nr,
+	       secs,
+	       (double)scans / secs,
+	       (double)updates / secs,
+	       conflicts);
+
+	return 0;
+}
+
+/*
+ * Measure reader / writer throughputs for each isolation level. Runs into a
+ * depot of its own since snapshot isolation requires KVS_DEPOT_MVCC.
+ */
+static int
+kvs_bench_run_isol(const struct kvs_bench_conf *conf,
+                   const struct kvs_depot      *depot)
+{
+	static const struct kvs_bench_isol_mode modes[] = {
+		{ .name = "serializable",     .flags = 0 },
+		{ .name = "read-committed",   .flags = KVS_XACT_READ_COMMITTED },
+		{ .name = "read-uncommitted", .flags = KVS_XACT_READ_UNCOMMITTED },
+		{ .name = "snapshot",         .flags = KVS_XACT_SNAPSHOT }
+	};
+	const struct kvs_store_conf             sconf = {
+		.flags = KVS_STORE_DIRTY_READ
+	};
+	struct kvs_depot_conf                   dconf = {
+		.cache_size = conf->cache
+	};
+	struct kvs_depot                        isol;
+	struct kvs_store                        store;
+	char                                   *path;
+	unsigned int                            m;
+	int                                     err;
+
+	/* Isolation levels are measured into a depot of their own. */
+	(void)depot;
+
+	if (asprintf(&path, "%s/isolation", conf->path) < 0)
+		return -ENOMEM;
+
+	err = kvs_open_depot_conf(&isol,
+	                          path,
+	                          KVS_BENCH_LOG_SIZE,
+	                          &dconf,
+	                          KVS_DEPOT_THREAD | KVS_DEPOT_MVCC,
+	                          S_IRWXU);
+	free(path);
+	if (err) {
+		kvs_bench_err("open isolation depot", err);
+		return err;
+	}
+
+	err = kvs_strrec_open_conf(&store,
+	                           &isol,
+	                           NULL,
+	                           "isolation.db",
+	                           NULL,
+	                           &sconf,
+	                           S_IRWXU);
+	if (err) {
+		kvs_bench_err("open isolation store", err);
+		goto close;
+	}
+
+	err = kvs_bench_fill_strrec(conf, &isol, &store, kvs_bench_rec_key);
+	if (err) {
+		kvs_bench_err("fill isolation store", err);
+		goto close;
+	}
+
+	for (m = 0; m < (sizeof(modes) / sizeof(modes[0])); m++) {
+		err = kvs_bench_run_isol_mode(conf, &isol, &store, &modes[m]);
+		if (err) {
+			kvs_bench_err("run isolation workload", err);
+			break;
+		}
+	}
+
+close:
+	kvs_strrec_close(&store);
+
+	if (kvs_close_depot(&isol) && !err)
+		err = -EIO;
+
+	return err;
+}
+
+#define KVS_BENCH_XACT_READS (4U)
+
+struct kvs_bench_reader {
+	pthread_t                    thread;
+	unsigned int                 id;
+	const struct kvs_bench_conf *conf;
+	const struct kvs_depot      *depot;
+	const struct kvs_store      *store;
+	unsigned long                nr;
+	int                          err;
+};
+
+/* Look a few random records up through iterators of the same transaction. */
+static int
+kvs_bench_read_xact(const struct kvs_bench_reader *rdr, unsigned int *seed)
+{
+	char             key[KVS_BENCH_KEY_MAX];
+	struct kvs_chunk from = { .data = key };
+	struct kvs_xact  xact;
+	unsigned int     n;
+	int              err;
+
+	err = kvs_begin_xact(rdr->depot, NULL, &xact, 0);
+	if (err)
+		return err;
+
+	for (n = 0; !err && (n < KVS_BENCH_XACT_READS); n++) {
+		struct kvs_iter  iter;
+		struct kvs_chunk id;
+		struct kvs_chunk item;
+
+		from.size = kvs_bench_rec_key(
+			key,
+			(unsigned long)rand_r(seed) % rdr->conf->nr);
+
+		err = kvs_strrec_init_iter(rdr->store, &xact, &iter);
+		if (err)
+			break;
+
+		err = kvs_strrec_iter_seek(&iter, &from, &id, &item);
+
+		kvs_strrec_fini_iter(&iter);
+	}
+
+	return kvs_end_xact(&xact, err);
+}
+
+static void *
+kvs_bench_read(void *data)
+{
+	struct kvs_bench_reader *rdr = data;
+	unsigned int             seed = rdr->id;
+	unsigned long            n;
+
+	for (n = 0; n < rdr->nr; n++) {
+		int err;
+
+		err = kvs_bench_read_xact(rdr, &seed);
+		if (err) {
+			rdr->err = err;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static int
+kvs_bench_run_read_threads(const struct kvs_bench_conf *conf,
+                           const struct kvs_depot      *depot,
+                           const struct kvs_store      *store,
+                           unsigned int                 nr,
+                           double                      *secs)
+{
+	struct kvs_bench_reader *rdrs;
+	unsigned int             t;
+	double                   start;
+	int                      err = 0;
+
+	rdrs = calloc(nr, sizeof(rdrs[0]));
+	if (!rdrs)
+		return -ENOMEM;
+
+	start = kvs_bench_now();
+
+	for (t = 0; t < nr; t++) {
+		rdrs[t].id = t;
+		rdrs[t].conf = conf;
+		rdrs[t].depot = depot;
+		rdrs[t].store = store;
+		rdrs[t].nr = conf->nr / nr;
+
+		err = -pthread_create(&rdrs[t].thread,
+		                      NULL,
+		                      kvs_bench_read,
+		                      &rdrs[t]);
+		if (err)
+			break;
+	}
+
+	nr = t;
+	for (t = 0; t < nr; t++) {
+		pthread_join(rdrs[t].thread, NULL);
+		if (!err)
+			err = rdrs[t].err;
+	}
+
+	*secs = kvs_bench_now() - start;
+
+	free(rdrs);
+
+	return err;
+}
+
+/*
+ * Measure the rate of small read transactions, made of KVS_BENCH_XACT_READS
+ * short iterations each, against the number of threads. Shows the benefit of
+ * per-thread cursor caching when built with CONFIG_KVSTORE_CURS_CACHE.
+ */
+static int
+kvs_bench_run_xact(const struct kvs_bench_conf *conf,
+                   const struct kvs_depot      *depot)
+{
+#if defined(CONFIG_KVSTORE_CURS_CACHE)
+	static const char     *mode = "cached";
+#else  /* !defined(CONFIG_KVSTORE_CURS_CACHE) */
+	static const char     *mode = "uncached";
+#endif /* defined(CONFIG_KVSTORE_CURS_CACHE) */
+	struct kvs_depot_conf  dconf = {
+		.cache_size = conf->cache
+	};
+	struct kvs_depot       xdepot;
+	struct kvs_store       store;
+	char                  *path;
+	unsigned int           nr;
+	int                    err;
+
+	/* Concurrent threads require a depot of their own. */
+	(void)depot;
+
+	if (asprintf(&path, "%s/xact", conf->path) < 0)
+		return -ENOMEM;
+
+	err = kvs_open_depot_conf(&xdepot,
+	                          path,
+	                          KVS_BENCH_LOG_SIZE,
+	                          &dconf,
+	                          KVS_DEPOT_THREAD,
+	                          S_IRWXU);
+	free(path);
+	if (err) {
+		kvs_bench_err("open xact depot", err);
+		return err;
+	}
+
+	err = kvs_strrec_open(&store,
+	                      &xdepot,
+	                      NULL,
+	                      "xact.db",
+	                      NULL,
+	                      S_IRWXU);
+	if (err) {
+		kvs_bench_err("open xact store", err);
+		goto close;
+	}
+
+	err = kvs_bench_fill_strrec(conf, &xdepot, &store, kvs_bench_rec_key);
+	if (err) {
+		kvs_bench_err("fill xact store", err);
+		goto close;
+	}
+
+	for (nr = 1; nr <= conf->threads; nr *= 2) {
+		double secs;
+
+		err = kvs_bench_run_read_threads(conf, &xdepot, &store, nr, &secs);
+		if (err) {
+			kvs_bench_err("run read transactions", err);
+			break;
+		}
+
+		printf("%-8s %-12s threads=%u xacts=%lu secs=%.6f "
+		       "rate=%.0f xact/s\n",
+		       "xact",
+		       mode,
+		       nr,
+		       (conf->nr / nr) * nr,
+		       secs,
+		       (double)((conf->nr / nr) * nr) / secs);
+	}
+
+close:
+	kvs_strrec_close(&store);
+
+	if (kvs_close_depot(&xdepot) && !err)
+		err = -EIO;
+
+	return err;
+}
+
+/******************************************************************************
+ * Benchmark suite
+ *
+ * Run point get / put / delete, full scan and mixed read / write workloads
+ * over each store type, each type into a depot of its own. Every operation is
+ * performed into a transaction of its own thanks to kvs_run_xact() except
+ * initial loading which inserts records by batches of KVS_BENCH_XACT_NR.
+ * Operation latencies are sampled by the benchmark itself so that percentiles
+ * are available whether CONFIG_KVSTORE_LATENCY is enabled or not.
+ ******************************************************************************/
+
+#define KVS_BENCH_KEY_SIZE   (16U)
+#define KVS_BENCH_READ_PCT   (90U)
+/* Size of the record number prefix stored at the head of suite items. */
+#define KVS_BENCH_FIELD_SIZE (16U)
+
+static const char * const kvs_bench_op_names[KVS_BENCH_OP_NR] = {
+	[KVS_BENCH_LOAD]  = "load",
+	[KVS_BENCH_GET]   = "get",
+	[KVS_BENCH_PUT]   = "put",
+	[KVS_BENCH_SCAN]  = "scan",
+	[KVS_BENCH_MIXED] = "mixed",
+	[KVS_BENCH_DEL]   = "del"
+};
+
+struct kvs_bench_suite;
+struct kvs_bench_worker;
+
+/*
+ * Store type operations. Record operations are given the worker with key and
+ * item of the current record already built. Mixed workload relies upon get and
+ * put operations. Unsupported operations are left NULL and skipped.
+ */
+struct kvs_bench_type {
+	const char  *name;
+	int        (*open)(struct kvs_bench_suite *suite);
+	int        (*close)(struct kvs_bench_suite *suite);
+	int        (*init_worker)(struct kvs_bench_worker *wrk);
+	void       (*fini_worker)(struct kvs_bench_worker *wrk);
+	kvs_xact_fn *ops[KVS_BENCH_OP_NR];
+};
+
+struct kvs_bench_suite {
+	const struct kvs_bench_conf *conf;
+	const struct kvs_bench_type *type;
+	unsigned long                nr;
+	struct kvs_depot             depot;
+	struct kvs_store             data;
+	const struct kvs_store      *store;
+#if defined(CONFIG_KVSTORE_TABLE)
+	struct kvs_table             table;
+#endif
+#if defined(CONFIG_KVSTORE_AUTOREC)
+	uint64_t                    *ids;
+#endif
+};
+
+struct kvs_bench_worker {
+	pthread_t                     thread;
+	const struct kvs_bench_suite *suite;
+	enum kvs_bench_op             op;
+	unsigned long                 first;
+	unsigned long                 nr;
+	unsigned long                 done;
+	unsigned long                 rec;
+	unsigned int                  seed;
+	char                         *key;
+	struct kvs_chunk              id;
+	char                         *value;
+	struct kvs_chunk              item;
+	char                         *buff;
+	unsigned long long           *lat;
+	unsigned long                 lat_max;
+	unsigned long                 lat_nr;
+#if defined(CONFIG_KVSTORE_FILE)
+	struct kvs_file               file;
+#endif
+	int                           err;
+};
+
+static unsigned long long
+kvs_bench_nsecs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((unsigned long long)now.tv_sec * 1000000000ULL) +
+	       (unsigned long long)now.tv_nsec;
+}
+
+static void
+kvs_bench_suite_sample(struct kvs_bench_worker *wrk, unsigned long long start)
+{
+	if (wrk->lat_nr < wrk->lat_max)
+		wrk->lat[wrk->lat_nr++] = kvs_bench_nsecs() - start;
+}
+
+/* Account for one scan step and return the start time of the next one. */
+static unsigned long long
+kvs_bench_suite_step(struct kvs_bench_worker *wrk, unsigned long long start)
+{
+	unsigned long long now = kvs_bench_nsecs();
+
+	if (wrk->lat_nr < wrk->lat_max)
+		wrk->lat[wrk->lat_nr++] = now - start;
+	wrk->done++;
+
+	return now;
+}
+
+/* Scans may be retried: drop samples of previous attempts. */
+static void
+kvs_bench_suite_rewind(struct kvs_bench_worker *wrk)
+{
+	wrk->lat_nr = 0;
+	wrk->done = 0;
+}
+
+/* Build key and item of record rec into worker buffers. */
+static void
+kvs_bench_suite_prep(struct kvs_bench_worker *wrk, unsigned long rec)
+{
+	const struct kvs_bench_conf *conf = wrk->suite->conf;
+	char                         field[KVS_BENCH_FIELD_SIZE + 1];
+
+	wrk->rec = rec;
+	wrk->id.size = (size_t)sprintf(wrk->key,
+	                               "%0*lu",
+	                               (int)conf->key_size,
+	                               rec);
+
+	snprintf(field, sizeof(field), "%0*lu", KVS_BENCH_FIELD_SIZE, rec);
+	memcpy(wrk->value,
+	       field,
+	       (conf->size < KVS_BENCH_FIELD_SIZE) ? conf->size :
+	                                              KVS_BENCH_FIELD_SIZE);
+}
+
+static int
+kvs_bench_strrec_get(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+	struct kvs_chunk               item;
+
+	return kvs_strrec_get_byid(wrk->suite->store, xact, &wrk->id, &item);
+}
+
+static int
+kvs_bench_strrec_put(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+
+	return kvs_strrec_put(wrk->suite->store, xact, &wrk->id, &wrk->item);
+}
+
+static int
+kvs_bench_strrec_del(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+
+	return kvs_strrec_del_byid(wrk->suite->store, xact, &wrk->id);
+}
+
+static int
+kvs_bench_strrec_scan(const struct kvs_xact *xact, void *data)
+{
+	struct kvs_bench_worker *wrk = data;
+	struct kvs_iter          iter;
+	struct kvs_chunk         id;
+	struct kvs_chunk         item;
+	unsigned long long       start;
+	int                      err;
+
+	err = kvs_strrec_init_iter(wrk->suite->store, xact, &iter);
+	if (err)
+		return err;
+
+	kvs_bench_suite_rewind(wrk);
+	start = kvs_bench_nsecs();
+	for (err = kvs_strrec_iter_first(&iter, &id, &item);
+	     !err;
+	     err = kvs_strrec_iter_next(&iter, &id, &item))
+		start = kvs_bench_suite_step(wrk, start);
+
+	kvs_strrec_fini_iter(&iter);
+
+	return (err == DB_NOTFOUND) ? 0 : err;
+}
+
+static int
+kvs_bench_strrec_open(struct kvs_bench_suite *suite)
+{
+	suite->store = &suite->data;
+
+	return kvs_strrec_open(&suite->data,
+	                       &suite->depot,
+	                       NULL,
+	                       "strrec.db",
+	                       NULL,
+	                       S_IRWXU);
+}
+
+static int
+kvs_bench_strrec_close(struct kvs_bench_suite *suite)
+{
+	return kvs_strrec_close(&suite->data);
+}
+
+#if defined(CONFIG_KVSTORE_ATTR)
+
+static int
+kvs_bench_attr_get(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+	size_t                         size = wrk->suite->conf->size;
+
+	return kvs_attr_load_data(wrk->suite->store,
+	                          xact,
+	                          (unsigned int)wrk->rec,
+	                          wrk->buff,
+	                          &size);
+}
+
+static int
+kvs_bench_attr_put(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+
+	return kvs_attr_store_num(wrk->suite->store,
+	                          xact,
+	                          (unsigned int)wrk->rec,
+	                          wrk->item.data,
+	                          wrk->item.size);
+}
+
+static int
+kvs_bench_attr_del(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+
+	return kvs_attr_clear(wrk->suite->store, xact, (unsigned int)wrk->rec);
+}
+
+static int
+kvs_bench_attr_scan(const struct kvs_xact *xact, void *data)
+{
+	struct kvs_bench_worker   *wrk = data;
+	struct kvs_iter            iter;
+	struct kvs_attr_iter_elem  elem;
+	unsigned long long         start;
+	int                        err;
+
+	err = kvs_attr_init_iter(wrk->suite->store, xact, &iter);
+	if (err)
+		return err;
+
+	kvs_bench_suite_rewind(wrk);
+	start = kvs_bench_nsecs();
+	for (err = kvs_attr_iter_first(&iter, &elem);
+	     !err;
+	     err = kvs_attr_iter_next(&iter, &elem))
+		start = kvs_bench_suite_step(wrk, start);
+
+	kvs_attr_fini_iter(&iter);
+
+	return (err == DB_NOTFOUND) ? 0 : err;
+}
+
+static int
+kvs_bench_attr_open(struct kvs_bench_suite *suite)
+{
+	int err;
+
+	/* Attribute identifiers are unsigned integers. */
+	if (suite->nr >= UINT_MAX)
+		return -ERANGE;
+
+	suite->store = &suite->data;
+
+	err = kvs_attr_open(&suite->data,
+	                    &suite->depot,
+	                    NULL,
+	                    "attr.db",
+	                    NULL,
+	                    S_IRWXU);
+#if defined(CONFIG_KVSTORE_ATTR_CACHE)
+	if (!err && suite->nr) {
+		err = kvs_attr_enable_cache(&suite->data,
+		                            (unsigned int)suite->nr);
+		if (err)
+			kvs_attr_close(&suite->data);
+	}
+#endif /* defined(CONFIG_KVSTORE_ATTR_CACHE) */
+
+	return err;
+}
+
+static int
+kvs_bench_attr_close(struct kvs_bench_suite *suite)
+{
+	return kvs_attr_close(&suite->data);
+}
+
+#endif /* defined(CONFIG_KVSTORE_ATTR) */
+
+#if defined(CONFIG_KVSTORE_AUTOREC)
+
+/*
+ * Record IDs are allocated by libdb: remember them at loading time to address
+ * records by number afterwards.
+ */
+static int
+kvs_bench_autorec_add(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+
+	return kvs_autorec_add(wrk->suite->store,
+	                       xact,
+	                       &wrk->suite->ids[wrk->rec],
+	                       &wrk->item);
+}
+
+static int
+kvs_bench_autorec_get(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+	struct kvs_chunk               item;
+
+	return kvs_autorec_get_byid(wrk->suite->store,
+	                            xact,
+	                            wrk->suite->ids[wrk->rec],
+	                            &item);
+}
+
+static int
+kvs_bench_autorec_put(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+
+	return kvs_autorec_update(wrk->suite->store,
+	                          xact,
+	                          wrk->suite->ids[wrk->rec],
+	                          &wrk->item);
+}
+
+static int
+kvs_bench_autorec_del(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+
+	return kvs_autorec_del_byid(wrk->suite->store,
+	                            xact,
+	                            wrk->suite->ids[wrk->rec]);
+}
+
+static int
+kvs_bench_autorec_scan(const struct kvs_xact *xact, void *data)
+{
+	struct kvs_bench_worker *wrk = data;
+	struct kvs_iter          iter;
+	uint64_t                 id;
+	struct kvs_chunk         item;
+	unsigned long long       start;
+	int                      err;
+
+	err = kvs_autorec_init_iter(wrk->suite->store, xact, &iter);
+	if (err)
+		return err;
+
+	kvs_bench_suite_rewind(wrk);
+	start = kvs_bench_nsecs();
+	for (err = kvs_autorec_iter_first(&iter, &id, &item);
+	     !err;
+	     err = kvs_autorec_iter_next(&iter, &id, &item))
+		start = kvs_bench_suite_step(wrk, start);
+
+	kvs_autorec_fini_iter(&iter);
+
+	return (err == DB_NOTFOUND) ? 0 : err;
+}
+
+static int
+kvs_bench_autorec_open(struct kvs_bench_suite *suite)
+{
+	int err;
+
+	suite->ids = malloc(suite->nr * sizeof(suite->ids[0]));
+	if (!suite->ids)
+		return -ENOMEM;
+
+	suite->store = &suite->data;
+
+	err = kvs_autorec_open(&suite->data,
+	                       &suite->depot,
+	                       NULL,
+	                       "autorec.db",
+	                       S_IRWXU);
+	if (err)
+		free(suite->ids);
+
+	return err;
+}
+
+static int
+kvs_bench_autorec_close(struct kvs_bench_suite *suite)
+{
+	free(suite->ids);
+
+	return kvs_autorec_close(&suite->data);
+}
+
+#endif /* defined(CONFIG_KVSTORE_AUTOREC) */
+
+#if defined(CONFIG_KVSTORE_TABLE)
+
+/* Index records by the record number prefix of their item. */
+static int
+kvs_bench_table_bind(const struct kvs_chunk *pkey __unused,
+                     const struct kvs_chunk *item,
+                     struct kvs_chunk       *skey)
+{
+	skey->data = item->data;
+	skey->size = (item->size < KVS_BENCH_FIELD_SIZE) ? 0 :
+	                                                   KVS_BENCH_FIELD_SIZE;
+
+	return 0;
+}
+
+static int
+kvs_bench_table_open_data(struct kvs_table       *table,
+                          const struct kvs_depot *depot,
+                          const struct kvs_xact  *xact,
+                          mode_t                  mode)
+{
+	return kvs_strrec_open(&table->data,
+	                       depot,
+	                       xact,
+	                       "table.db",
+	                       "data",
+	                       mode);
+}
+
+static int
+kvs_bench_table_close_data(const struct kvs_table *table)
+{
+	return kvs_strrec_close(&table->data);
+}
+
+static int
+kvs_bench_table_open_indx(struct kvs_table       *table,
+                          const struct kvs_depot *depot,
+                          const struct kvs_xact  *xact,
+                          mode_t                  mode)
+{
+	return kvs_open_indx(kvs_table_get_indx_store(table, 0),
+	                     &table->data,
+	                     depot,
+	                     xact,
+	                     "table.db",
+	                     "field",
+	                     mode,
+	                     kvs_bench_table_bind);
+}
+
+static int
+kvs_bench_table_close_indx(const struct kvs_table *table)
+{
+	return kvs_close_indx(kvs_table_get_indx_store(table, 0));
+}
+
+static const struct kvs_table_desc kvs_bench_table_desc = {
+	.data_ops = {
+		.open  = kvs_bench_table_open_data,
+		.close = kvs_bench_table_close_data
+	},
+	.indx_nr  = 1,
+	.indx_ops = {
+		{
+			.open  = kvs_bench_table_open_indx,
+			.close = kvs_bench_table_close_indx
+		}
+	}
+};
+
+/* Lookup records through the index; updates go through the primary store. */
+static int
+kvs_bench_table_get(const struct kvs_xact *xact, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+	const struct kvs_chunk         field = {
+		.data = wrk->value,
+		.size = KVS_BENCH_FIELD_SIZE
+	};
+	struct kvs_chunk               id;
+	struct kvs_chunk               item;
+
+	return kvs_strrec_get_byfield(
+		kvs_table_get_indx_store(&wrk->suite->table, 0),
+		xact,
+		&field,
+		&id,
+		&item);
+}
+
+static int
+kvs_bench_table_open(struct kvs_bench_suite *suite)
+{
+	int err;
+
+	/* Items must be large enough to hold indexed field. */
+	if (suite->conf->size < KVS_BENCH_FIELD_SIZE)
+		return -EINVAL;
+
+	err = kvs_table_init(&suite->table, &kvs_bench_table_desc);
+	if (err)
+		return err;
+
+	err = kvs_table_open(&suite->table, &suite->depot, NULL, S_IRWXU);
+	if (err) {
+		kvs_table_close(&suite->table);
+		kvs_table_exit(&suite->table);
+		return err;
+	}
+
+	suite->store = kvs_table_get_data_store(&suite->table);
+
+	return 0;
+}
+
+static int
+kvs_bench_table_close(struct kvs_bench_suite *suite)
+{
+	int err;
+
+	err = kvs_table_close(&suite->table);
+	kvs_table_exit(&suite->table);
+
+	return err;
+}
+
+#endif /* defined(CONFIG_KVSTORE_TABLE) */
+
+#if defined(CONFIG_KVSTORE_FILE)
+
+/*
+ * Files are realized under the depot home directory and named after record
+ * keys. There is no file deletion nor iteration API: only get and put
+ * operations are supported, get reading files back from the filesystem.
+ */
+static int
+kvs_bench_file_get(const struct kvs_xact *xact __unused, void *data)
+{
+	const struct kvs_bench_worker *wrk = data;
+	int                            fd;
+	ssize_t                        ret;
+	int                            err = 0;
+
+	fd = openat(wrk->file.dir, wrk->key, O_RDONLY | O_NOFOLLOW);
+	if (fd < 0)
+		return -errno;
+
+	ret = read(fd, wrk->buff, wrk->suite->conf->size);
+	if (ret < 0)
+		err = -errno;
+
+	close(fd);
+
+	return err;
+}
+
+static int
+kvs_bench_file_put(const struct kvs_xact *xact, void *data)
+{
+	struct kvs_bench_worker *wrk = data;
+	int                      err;
+
+	/* Reuse file content buffer from one record to the other. */
+	wrk->file.off = 0;
+
+	err = kvs_file_write(&wrk->file, wrk->item.data, wrk->item.size);
+	if (err)
+		return err;
+
+	return kvs_file_realize(&wrk->file, xact, wrk->key, S_IRUSR | S_IWUSR);
+}
+
+static int
+kvs_bench_file_init_worker(struct kvs_bench_worker *wrk)
+{
+	return kvs_file_init(&wrk->file, &wrk->suite->depot);
+}
+
+static void
+kvs_bench_file_fini_worker(struct kvs_bench_worker *wrk)
+{
+	kvs_file_fini(&wrk->file);
+}
+
+static int
+kvs_bench_file_open(struct kvs_bench_suite *suite)
+{
+	suite->store = NULL;
+
+	return 0;
+}
+
+static int
+kvs_bench_file_close(struct kvs_bench_suite *suite __unused)
+{
+	return 0;
+}
+
+#endif /* defined(CONFIG_KVSTORE_FILE) */
+
+static const struct kvs_bench_type kvs_bench_types[] = {
+#if defined(CONFIG_KVSTORE_ATTR)
+	{
+		.name  = "attr",
+		.open  = kvs_bench_attr_open,
+		.close = kvs_bench_attr_close,
+		.ops   = {
+			[KVS_BENCH_LOAD] = kvs_bench_attr_put,
+			[KVS_BENCH_GET]  = kvs_bench_attr_get,
+			[KVS_BENCH_PUT]  = kvs_bench_attr_put,
+			[KVS_BENCH_SCAN] = kvs_bench_attr_scan,
+			[KVS_BENCH_DEL]  = kvs_bench_attr_del
+		}
+	},
+#endif /* defined(CONFIG_KVSTORE_ATTR) */
+	{
+		.name  = "strrec",
+		.open  = kvs_bench_strrec_open,
+		.close = kvs_bench_strrec_close,
+		.ops   = {
+			[KVS_BENCH_LOAD] = kvs_bench_strrec_put,
+			[KVS_BENCH_GET]  = kvs_bench_strrec_get,
+			[KVS_BENCH_PUT]  = kvs_bench_strrec_put,
+			[KVS_BENCH_SCAN] = kvs_bench_strrec_scan,
+			[KVS_BENCH_DEL]  = kvs_bench_strrec_del
+		}
+	},
+#if defined(CONFIG_KVSTORE_AUTOREC)
+	{
+		.name  = "autorec",
+		.open  = kvs_bench_autorec_open,
+		.close = kvs_bench_autorec_close,
+		.ops   = {
+			[KVS_BENCH_LOAD] = kvs_bench_autorec_add,
+			[KVS_BENCH_GET]  = kvs_bench_autorec_get,
+			[KVS_BENCH_PUT]  = kvs_bench_autorec_put,
+			[KVS_BENCH_SCAN] = kvs_bench_autorec_scan,
+			[KVS_BENCH_DEL]  = kvs_bench_autorec_del
+		}
+	},
+#endif /* defined(CONFIG_KVSTORE_AUTOREC) */
+#if defined(CONFIG_KVSTORE_TABLE)
+	{
+		.name  = "table",
+		.open  = kvs_bench_table_open,
+		.close = kvs_bench_table_close,
+		.ops   = {
+			[KVS_BENCH_LOAD] = kvs_bench_strrec_put,
+			[KVS_BENCH_GET]  = kvs_bench_table_get,
+			[KVS_BENCH_PUT]  = kvs_bench_strrec_put,
+			[KVS_BENCH_SCAN] = kvs_bench_strrec_scan,
+			[KVS_BENCH_DEL]  = kvs_bench_strrec_del
+		}
+	},
+#endif /* defined(CONFIG_KVSTORE_TABLE) */
+#if defined(CONFIG_KVSTORE_FILE)
+	{
+		.name        = "file",
+		.open        = kvs_bench_file_open,
+		.close       = kvs_bench_file_close,
+		.init_worker = kvs_bench_file_init_worker,
+		.fini_worker = kvs_bench_file_fini_worker,
+		.ops         = {
+			[KVS_BENCH_LOAD] = kvs_bench_file_put,
+			[KVS_BENCH_GET]  = kvs_bench_file_get,
+			[KVS_BENCH_PUT]  = kvs_bench_file_put
+		}
+	},
+#endif /* defined(CONFIG_KVSTORE_FILE) */
+};
+
+#define KVS_BENCH_TYPE_NR \
+	(sizeof(kvs_bench_types) / sizeof(kvs_bench_types[0]))
+
+static bool
+kvs_bench_suite_has_op(const struct kvs_bench_type *type,
+                       enum kvs_bench_op            op)
+{
+	if (op == KVS_BENCH_MIXED)
+		return type->ops[KVS_BENCH_GET] && type->ops[KVS_BENCH_PUT];
+
+	return !!type->ops[op];
+}
+
+/* Insert records of worker range by batches of KVS_BENCH_XACT_NR. */
+static int
+kvs_bench_suite_load(const struct kvs_xact *xact, void *data)
+{
+	struct kvs_bench_worker *wrk = data;
+	kvs_xact_fn             *load = wrk->suite->type->ops[KVS_BENCH_LOAD];
+	unsigned long            r;
+	unsigned long            end;
+	int                      err = 0;
+
+	/* Batch may be retried: drop samples of previous attempts. */
+	wrk->lat_nr = wrk->done;
+
+	r = wrk->first + wrk->done;
+	end = r + KVS_BENCH_XACT_NR;
+	if (end > (wrk->first + wrk->nr))
+		end = wrk->first + wrk->nr;
+
+	while (!err && (r < end)) {
+		unsigned long long start;
+
+		kvs_bench_suite_prep(wrk, r++);
+
+		start = kvs_bench_nsecs();
+		err = load(xact, wrk);
+		kvs_bench_suite_sample(wrk, start);
+	}
+
+	return err;
+}
+
+static void *
+kvs_bench_suite_work(void *data)
+{
+	struct kvs_bench_worker      *wrk = data;
+	const struct kvs_bench_suite *suite = wrk->suite;
+	const struct kvs_bench_type  *type = suite->type;
+	unsigned long                 n;
+	int                           err = 0;
+
+	switch (wrk->op) {
+	case KVS_BENCH_LOAD:
+		while (!err && (wrk->done < wrk->nr)) {
+			err = kvs_run_xact(&suite->depot,
+			                   NULL,
+			                   0,
+			                   kvs_bench_suite_load,
+			                   wrk,
+			                   NULL);
+			if (!err)
+				wrk->done = wrk->lat_nr;
+		}
+		break;
+
+	case KVS_BENCH_SCAN:
+		err = kvs_run_xact(&suite->depot,
+		                   NULL,
+		                   0,
+		                   type->ops[KVS_BENCH_SCAN],
+		                   wrk,
+		                   NULL);
+		break;
+
+	default:
+		for (n = 0; !err && (n < wrk->nr); n++) {
+			kvs_xact_fn        *fn = type->ops[wrk->op];
+			unsigned long       rec;
+			unsigned long long  start;
+
+			if (wrk->op == KVS_BENCH_DEL)
+				rec = wrk->first + n;
+			else
+				rec = (unsigned long)rand_r(&wrk->seed) %
+				      suite->nr;
+
+			if (wrk->op == KVS_BENCH_MIXED) {
+				unsigned int pct = (unsigned int)
+				                   rand_r(&wrk->seed) % 100U;
+
+				fn = (pct < suite->conf->ratio) ?
+				     type->ops[KVS_BENCH_GET] :
+				     type->ops[KVS_BENCH_PUT];
+			}
+
+			kvs_bench_suite_prep(wrk, rec);
+
+			start = kvs_bench_nsecs();
+			err = kvs_run_xact(&suite->depot,
+			                   NULL,
+			                   0,
+			                   fn,
+			                   wrk,
+			                   NULL);
+			kvs_bench_suite_sample(wrk, start);
+		}
+		wrk->done = n;
+	}
+
+	wrk->err = err;
+
+	return NULL;
+}
+
+static void
+kvs_bench_suite_fini_worker(struct kvs_bench_worker *wrk)
+{
+	const struct kvs_bench_type *type = wrk->suite->type;
+
+	if (type->fini_worker)
+		type->fini_worker(wrk);
+
+	free(wrk->lat);
+	free(wrk->buff);
+	free(wrk->value);
+	free(wrk->key);
+}
+
+static int
+kvs_bench_suite_init_worker(struct kvs_bench_worker      *wrk,
+                            const struct kvs_bench_suite *suite,
+                            enum kvs_bench_op             op,
+                            unsigned int                  id)
+{
+	const struct kvs_bench_conf *conf = suite->conf;
+	const struct kvs_bench_type *type = suite->type;
+	unsigned long                per = suite->nr / conf->threads;
+	int                          err;
+
+	wrk->suite = suite;
+	wrk->op = op;
+	wrk->first = id * per;
+	wrk->nr = per;
+	wrk->seed = id + 1;
+	/* Each thread scans the whole store. */
+	wrk->lat_max = (op == KVS_BENCH_SCAN) ? suite->nr : per;
+
+	/* Room for the widest record number whatever the key size. */
+	wrk->key = malloc(((conf->key_size > 20) ? conf->key_size : 20) + 1);
+	wrk->value = malloc(conf->size);
+	wrk->buff = malloc(conf->size);
+	wrk->lat = malloc(wrk->lat_max * sizeof(wrk->lat[0]));
+	if (!wrk->key || !wrk->value || !wrk->buff || !wrk->lat) {
+		err = -ENOMEM;
+		goto free;
+	}
+
+	memset(wrk->value, 0xa5, conf->size);
+	wrk->id.data = wrk->key;
+	wrk->item.data = wrk->value;
+	wrk->item.size = conf->size;
+
+	if (type->init_worker) {
+		err = type->init_worker(wrk);
+		if (err)
+			goto free;
+	}
+
+	return 0;
+
+free:
+	free(wrk->lat);
+	free(wrk->buff);
+	free(wrk->value);
+	free(wrk->key);
+
+	return err;
+}
+
+static int
+kvs_bench_cmp_lat(const void *first, const void *second)
+{
+	unsigned long long fst = *(const unsigned long long *)first;
+	unsigned long long snd = *(const unsigned long long *)second;
+
+	return (fst > snd) - (fst < snd);
+}
+
+/* Samples must be sorted. */
+static unsigned long long
+kvs_bench_lat_pct(const unsigned long long *lat, unsigned long nr, double pct)
+{
+	unsigned long rank;
+
+	if (!nr)
+		return 0;
+
+	rank = (unsigned long)((pct / 100) * (double)nr);
+	if (rank >= nr)
+		rank = nr - 1;
+
+	return lat[rank];
+}
+
+static void
+kvs_bench_suite_report(const struct kvs_bench_suite *suite,
+                       enum kvs_bench_op             op,
+                       unsigned long                 ops,
+                       double                        secs,
+                       const unsigned long long     *lat,
+                       unsigned long                 nr)
+{
+	const struct kvs_bench_conf *conf = suite->conf;
+	unsigned long long           sum = 0;
+	unsigned long long           avg = 0;
+	unsigned long                n;
+
+	for (n = 0; n < nr; n++)
+		sum += lat[n];
+	if (nr)
+		avg = sum / nr;
+
+	if (conf->json) {
+		printf("{\"workload\":\"suite\","
+		       "\"type\":\"%s\","
+		       "\"op\":\"%s\","
+		       "\"durability\":\"%s\","
+		       "\"threads\":%u,"
+		       "\"key_size\":%zu,"
+		       "\"value_size\":%zu,"
+		       "\"read_pct\":%u,"
+		       "\"ops\":%lu,"
+		       "\"secs\":%.6f,"
+		       "\"rate\":%.0f,"
+		       "\"lat_ns\":{\"avg\":%llu,\"p50\":%llu,\"p90\":%llu,"
+		       "\"p99\":%llu,\"p99.9\":%llu,\"max\":%llu}}\n",
+		       suite->type->name,
+		       kvs_bench_op_names[op],
+		       conf->mode->name,
+		       conf->threads,
+		       conf->key_size,
+		       conf->size,
+		       conf->ratio,
+		       ops,
+		       secs,
+		       (double)ops / secs,
+		       avg,
+		       kvs_bench_lat_pct(lat, nr, 50),
+		       kvs_bench_lat_pct(lat, nr, 90),
+		       kvs_bench_lat_pct(lat, nr, 99),
+		       kvs_bench_lat_pct(lat, nr, 99.9),
+		       nr ? lat[nr - 1] : 0);
+		return;
+	}
+
+	printf("%-8s %-8s threads=%u ops=%lu secs=%.6f rate=%.0f op/s "
+	       "avg=%lluns p50=%lluns p90=%lluns p99=%lluns p99.9=%lluns "
+	       "max=%lluns\n",
+	       suite->type->name,
+	       kvs_bench_op_names[op],
+	       conf->threads,
+	       ops,
+	       secs,
+	       (double)ops / secs,
+	       avg,
+	       kvs_bench_lat_pct(lat, nr, 50),
+	       kvs_bench_lat_pct(lat, nr, 90),
+	       kvs_bench_lat_pct(lat, nr, 99),
+	       kvs_bench_lat_pct(lat, nr, 99.9),
+	       nr ? lat[nr - 1] : 0);
+}
+
+static int
+kvs_bench_suite_run_op(const struct kvs_bench_suite *suite,
+                       enum kvs_bench_op             op,
+                       bool                          report)
+{
+	unsigned int             threads = suite->conf->threads;
+	struct kvs_bench_worker *wrks;
+	unsigned long long      *lat;
+	unsigned long            lat_nr = 0;
+	unsigned long            ops = 0;
+	unsigned int             nr;
+	unsigned int             t;
+	double                   start;
+	double                   secs;
+	int                      err = 0;
+
+	wrks = calloc(threads, sizeof(wrks[0]));
+	if (!wrks)
+		return -ENOMEM;
+
+	for (nr = 0; nr < threads; nr++) {
+		err = kvs_bench_suite_init_worker(&wrks[nr], suite, op, nr);
+		if (err)
+			goto fini;
+	}
+
+	start = kvs_bench_now();
+
+	for (t = 0; t < nr; t++) {
+		err = -pthread_create(&wrks[t].thread,
+		                      NULL,
+		                      kvs_bench_suite_work,
+		                      &wrks[t]);
+		if (err)
+			break;
+	}
+
+	while (t--) {
+		pthread_join(wrks[t].thread, NULL);
+		if (!err)
+			err = wrks[t].err;
+	}
+
+	secs = kvs_bench_now() - start;
+
+	if (err || !report)
+		goto fini;
+
+	for (t = 0; t < nr; t++) {
+		ops += wrks[t].done;
+		lat_nr += wrks[t].lat_nr;
+	}
+
+	lat = malloc(lat_nr * sizeof(lat[0]));
+	if (!lat) {
+		err = -ENOMEM;
+		goto fini;
+	}
+
+	for (t = 0, lat_nr = 0; t < nr; t++) {
+		memcpy(&lat[lat_nr],
+		       wrks[t].lat,
+		       wrks[t].lat_nr * sizeof(lat[0]));
+		lat_nr += wrks[t].lat_nr;
+	}
+
+	qsort(lat, lat_nr, sizeof(lat[0]), kvs_bench_cmp_lat);
+
+	kvs_bench_suite_report(suite, op, ops, secs, lat, lat_nr);
+
+	free(lat);
+
+fini:
+	while (nr--)
+		kvs_bench_suite_fini_worker(&wrks[nr]);
+
+	free(wrks);
+
+	return err;
+}
+
+static int
+kvs_bench_suite_run_type(const struct kvs_bench_conf *conf,
+                         const struct kvs_bench_type *type)
+{
+	struct kvs_depot_conf  dconf = {
+		.cache_size   = conf->cache,
+		.durability   = conf->mode->durability,
+		.group_commit = conf->mode->group
+	};
+	struct kvs_bench_suite suite = {
+		.conf = conf,
+		.type = type,
+		.nr   = (conf->nr / conf->threads) * conf->threads
+	};
+	char                  *path;
+	unsigned int           op;
+	int                    err;
+
+	if (asprintf(&path,
+	             "%s/suite-%s-%s",
+	             conf->path,
+	             type->name,
+	             conf->mode->name) < 0)
+		return -ENOMEM;
+
+	err = kvs_open_depot_conf(&suite.depot,
+	                          path,
+	                          KVS_BENCH_LOG_SIZE,
+	                          &dconf,
+	                          KVS_DEPOT_THREAD,
+	                          S_IRWXU);
+	free(path);
+	if (err) {
+		kvs_bench_err("open suite depot", err);
+		return err;
+	}
+
+	err = type->open(&suite);
+	if (err) {
+		kvs_bench_err("open suite store", err);
+		goto close_depot;
+	}
+
+	/*
+	 * Other operations need records: always load them. Deletion is also
+	 * run silently when not requested so that the next run starts from an
+	 * empty store.
+	 */
+	for (op = 0; op < KVS_BENCH_OP_NR; op++) {
+		bool report = !!(conf->ops & (1U << op));
+
+		if (!kvs_bench_suite_has_op(type, op))
+			continue;
+
+		if (!report && (op != KVS_BENCH_LOAD) && (op != KVS_BENCH_DEL))
+			continue;
+
+		err = kvs_bench_suite_run_op(&suite, op, report);
+		if (err) {
+			fprintf(stderr,
+			        "%s: %s %s workload failed: %s (%d).\n",
+			        kvs_bench_argv0,
+			        type->name,
+			        kvs_bench_op_names[op],
+			        kvs_strerror(err),
+			        err);
+			break;
+		}
+	}
+
+	if (type->close(&suite) && !err)
+		err = -EIO;
+
+close_depot:
+	if (kvs_close_depot(&suite.depot) && !err)
+		err = -EIO;
+
+	return err;
+}
+
+static int
+kvs_bench_run_suite(const struct kvs_bench_conf *conf,
+                    const struct kvs_depot      *depot)
+{
+	unsigned int t;
+	int          err;
+
+	/* Each store type runs into a depot of its own. */
+	(void)depot;
+
+	if (conf->nr < conf->threads)
+		return -EINVAL;
+
+	for (t = 0; t < KVS_BENCH_TYPE_NR; t++) {
+		if (!(conf->types & (1U << t)))
+			continue;
+
+		err = kvs_bench_suite_run_type(conf, &kvs_bench_types[t]);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ * Scaling benchmark
+ *
+ * Run concurrent workers against a single shared depot, either as threads of
+ * one process sharing a KVS_DEPOT_THREAD depot handle, or as forked processes
+ * each opening the depot on its own, regions being shared through System V
+ * shared memory (DB_SYSTEM_MEM / DB_REGISTER). For each workload, the number of
+ * workers doubles from 1 up to the configured number of threads.
+ ******************************************************************************/
+
+#define KVS_BENCH_HOT_NR (16UL)
+
+struct kvs_bench_scale_load {
+	const char    *name;
+	unsigned int   read_pct;
+	unsigned long  hot_nr;
+};
+
+static const struct kvs_bench_scale_load kvs_bench_scale_loads[] = {
+	{ .name = "read",  .read_pct = 95 },
+	{ .name = "write", .read_pct = 10 },
+	{ .name = "hot",   .read_pct = 50, .hot_nr = KVS_BENCH_HOT_NR }
+};
+
+/* Per worker results, mapped shared so that child processes may report. */
+struct kvs_bench_scale_res {
+	unsigned long         ops;
+	unsigned long         giveups;
+	unsigned long long    lost;
+	struct kvs_xact_stats stats;
+	int                   err;
+};
+
+struct kvs_bench_scale_worker {
+	pthread_t                          thread;
+	unsigned int                       id;
+	const char                        *path;
+	const struct kvs_bench_conf       *conf;
+	const struct kvs_bench_scale_load *load;
+	const struct kvs_depot            *depot;
+	const struct kvs_store            *store;
+	unsigned long                      nr;
+	struct kvs_bench_scale_res        *res;
+};
+
+struct kvs_bench_scale_op {
+	const struct kvs_store *store;
+	bool                    read;
+	char                    key[KVS_BENCH_KEY_MAX];
+	struct kvs_chunk        id;
+	struct kvs_chunk        item;
+	unsigned long long      attempt;
+};
+
+/*
+ * Updates are read-modify-write transactions so that concurrent updates of the
+ * same record may deadlock while upgrading their read locks.
+ */
+static int
+kvs_bench_scale_xact(const struct kvs_xact *xact, void *data)
+{
+	struct kvs_bench_scale_op *op = data;
+	struct kvs_chunk           item;
+	int                        err;
+
+	op->attempt = kvs_bench_nsecs();
+
+	err = kvs_strrec_get_byid(op->store, xact, &op->id, &item);
+	if (err || op->read)
+		return err;
+
+	return kvs_strrec_put(op->store, xact, &op->id, &op->item);
+}
+
+static int
+kvs_bench_scale_run(const struct kvs_bench_scale_worker *wrk)
+{
+	struct kvs_bench_scale_res  *res = wrk->res;
+	const struct kvs_xact_retry  retry = {
+		.max_nr    = KVS_XACT_RETRY_NR,
+		.min_delay = KVS_XACT_DELAY_MIN,
+		.max_delay = KVS_XACT_DELAY_MAX,
+		.stats     = &res->stats
+	};
+	struct kvs_bench_scale_op    op = { .store = wrk->store };
+	unsigned long                span = wrk->conf->nr;
+	unsigned int                 seed = wrk->id + 1;
+	char                        *data;
+	unsigned long                n;
+	int                          err = 0;
+
+	data = malloc(wrk->conf->size);
+	if (!data)
+		return -ENOMEM;
+	memset(data, 0x5a, wrk->conf->size);
+
+	if (wrk->load->hot_nr && (wrk->load->hot_nr < span))
+		span = wrk->load->hot_nr;
+
+	op.id.data = op.key;
+	op.item.data = data;
+	op.item.size = wrk->conf->size;
+
+	for (n = 0; n < wrk->nr; n++) {
+		unsigned long long start;
+
+		op.read = ((unsigned int)rand_r(&seed) % 100U) <
+		          wrk->load->read_pct;
+		op.id.size = kvs_bench_rec_key(op.key,
+		                               (unsigned long)rand_r(&seed) %
+		                               span);
+
+		start = kvs_bench_nsecs();
+		op.attempt = start;
+		err = kvs_run_xact(wrk->depot,
+		                   NULL,
+		                   0,
+		                   kvs_bench_scale_xact,
+		                   &op,
+		                   &retry);
+
+		/* Time spent into aborted attempts and retry delays. */
+		res->lost += op.attempt - start;
+
+		if (kvs_bench_isol_conflict(err)) {
+			res->giveups++;
+			err = 0;
+			continue;
+		}
+		if (err)
+			break;
+
+		res->ops++;
+	}
+
+	free(data);
+
+	return err;
+}
+
+static void *
+kvs_bench_scale_thread(void *data)
+{
+	const struct kvs_bench_scale_worker *wrk = data;
+
+	wrk->res->err = kvs_bench_scale_run(wrk);
+
+	return NULL;
+}
+
+static int
+kvs_bench_scale_threads(struct kvs_bench_scale_worker *wrks,
+                        unsigned int                   nr,
+                        double                        *secs)
+{
+	unsigned int t;
+	double       start;
+	int          err = 0;
+
+	start = kvs_bench_now();
+
+	for (t = 0; t < nr; t++) {
+		err = -pthread_create(&wrks[t].thread,
+		                      NULL,
+		                      kvs_bench_scale_thread,
+		                      &wrks[t]);
+		if (err)
+			break;
+	}
+
+	while (t--)
+		pthread_join(wrks[t].thread, NULL);
+
+	*secs = kvs_bench_now() - start;
+
+	return err;
+}
+
+/*
+ * Child processes must not use depot handles inherited from their parent: each
+ * one opens the depot on its own, signals it is ready and waits for the parent
+ * to close the go pipe so that all of them start at once.
+ */
+static void
+kvs_bench_scale_child(struct kvs_bench_scale_worker *wrk, int ready, int go)
+{
+	const struct kvs_depot_conf dconf = { .cache_size = wrk->conf->cache };
+	struct kvs_depot            depot;
+	struct kvs_store            store;
+	char                        byte = 0;
+	int                         err;
+
+	err = kvs_open_depot_conf(&depot,
+	                          wrk->path,
+	                          KVS_BENCH_LOG_SIZE,
+	                          &dconf,
+	                          0,
+	                          S_IRWXU);
+	if (!err) {
+		err = kvs_strrec_open(&store,
+		                      &depot,
+		                      NULL,
+		                      "scale.db",
+		                      NULL,
+		                      S_IRWXU);
+		if (err)
+			kvs_close_depot(&depot);
+	}
+
+	/* Signal readiness even on error so that parent does not wait. */
+	if ((write(ready, &byte, 1) != 1) && !err)
+		err = -errno;
+	close(ready);
+
+	/* Returns end-of-file once parent closed its end. */
+	while ((read(go, &byte, 1) < 0) && (errno == EINTR))
+		;
+	close(go);
+
+	if (!err) {
+		wrk->depot = &depot;
+		wrk->store = &store;
+		err = kvs_bench_scale_run(wrk);
+
+		kvs_strrec_close(&store);
+		if (kvs_close_depot(&depot) && !err)
+			err = -EIO;
+	}
+
+	wrk->res->err = err;
+
+	/* Don't run atexit handlers nor flush stdio inherited from parent. */
+	_exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static int
+kvs_bench_scale_procs(struct kvs_bench_scale_worker *wrks,
+                      unsigned int                   nr,
+                      double                        *secs)
+{
+	pid_t        *pids;
+	int           ready[2];
+	int           go[2];
+	unsigned int  p;
+	unsigned int  r;
+	char          byte;
+	double        start;
+	int           err = -ENOMEM;
+
+	pids = malloc(nr * sizeof(pids[0]));
+	if (!pids)
+		return err;
+
+	if (pipe(ready)) {
+		err = -errno;
+		goto free;
+	}
+
+	if (pipe(go)) {
+		err = -errno;
+		goto close_ready;
+	}
+
+	err = 0;
+	fflush(NULL);
+	for (p = 0; p < nr; p++) {
+		pids[p] = fork();
+		if (pids[p] < 0) {
+			err = -errno;
+			break;
+		}
+
+		if (!pids[p]) {
+			close(ready[0]);
+			close(go[1]);
+			kvs_bench_scale_child(&wrks[p], ready[1], go[0]);
+		}
+	}
+
+	close(ready[1]);
+	close(go[0]);
+
+	for (r = 0; r < p; r++)
+		if (read(ready[0], &byte, 1) != 1)
+			break;
+
+	/* Release children. */
+	start = kvs_bench_now();
+	close(go[1]);
+
+	for (r = 0; r < p; r++) {
+		int stat;
+
+		while (waitpid(pids[r], &stat, 0) < 0)
+			if (errno != EINTR)
+				break;
+
+		if (!err && (!WIFEXITED(stat) || WEXITSTATUS(stat)))
+			err = wrks[r].res->err ? : -ECHILD;
+	}
+
+	*secs = kvs_bench_now() - start;
+
+	close(ready[0]);
+	free(pids);
+
+	return err;
+
+close_ready:
+	close(ready[0]);
+	close(ready[1]);
+free:
+	free(pids);
+
+	return err;
+}
+
+static void
+kvs_bench_scale_report(const struct kvs_bench_conf        *conf,
+                       const char                         *topo,
+                       const struct kvs_bench_scale_load  *load,
+                       unsigned int                        nr,
+                       const struct kvs_bench_scale_res   *res,
+                       const struct kvs_depot_stats       *dstats,
+                       double                              secs)
+{
+	unsigned long      ops = 0;
+	unsigned long      giveups = 0;
+	unsigned long      retries = 0;
+	unsigned long      deadlocks = 0;
+	unsigned long long lost = 0;
+	double             dlk_rate;
+	double             wait_pct = 0;
+	unsigned int       w;
+
+	for (w = 0; w < nr; w++) {
+		ops += res[w].ops;
+		giveups += res[w].giveups;
+		retries += res[w].stats.retry_nr;
+		deadlocks += res[w].stats.deadlock_nr;
+		lost += res[w].lost;
+	}
+
+	/* Deadlocks per thousand transactions. */
+	dlk_rate = (double)deadlocks * 1000 / (double)(ops + giveups);
+	if (dstats->lock_req)
+		wait_pct = (double)dstats->lock_wait * 100 /
+		           (double)dstats->lock_req;
+
+	if (conf->json) {
+		printf("{\"workload\":\"scale\","
+		       "\"topology\":\"%s\","
+		       "\"load\":\"%s\","
+		       "\"workers\":%u,"
+		       "\"ops\":%lu,"
+		       "\"secs\":%.6f,"
+		       "\"rate\":%.0f,"
+		       "\"deadlocks\":%lu,"
+		       "\"deadlock_rate\":%.3f,"
+		       "\"retries\":%lu,"
+		       "\"giveups\":%lu,"
+		       "\"lock_waits\":%llu,"
+		       "\"lock_wait_pct\":%.3f,"
+		       "\"lost_ms\":%.3f}\n",
+		       topo,
+		       load->name,
+		       nr,
+		       ops,
+		       secs,
+		       (double)ops / secs,
+		       deadlocks,
+		       dlk_rate,
+		       retries,
+		       giveups,
+		       dstats->lock_wait,
+		       wait_pct,
+		       (double)lost / 1e6);
+		return;
+	}
+
+	printf("%-8s %-8s %-8s workers=%u ops=%lu secs=%.6f rate=%.0f op/s "
+	       "deadlocks=%lu (%.3f/kop) retries=%lu giveups=%lu "
+	       "lock_waits=%llu (%.3f%%) lost=%.3fms\n",
+	       "scale",
+	       topo,
+	       load->name,
+	       nr,
+	       ops,
+	       secs,
+	       (double)ops / secs,
+	       deadlocks,
+	       dlk_rate,
+	       retries,
+	       giveups,
+	       dstats->lock_wait,
+	       wait_pct,
+	       (double)lost / 1e6);
+}
+
+static int
+kvs_bench_scale_config(const struct kvs_bench_conf       *conf,
+                       const char                        *topo,
+                       const char                        *path,
+                       const struct kvs_depot            *depot,
+                       const struct kvs_store            *store,
+                       const struct kvs_bench_scale_load *load,
+                       unsigned int                       nr,
+                       bool                               procs)
+{
+	struct kvs_bench_scale_res    *res;
+	struct kvs_bench_scale_worker *wrks;
+	struct kvs_depot_stats         dstats;
+	unsigned int                   w;
+	double                         secs;
+	int                            err;
+
+	res = mmap(NULL,
+	           nr * sizeof(res[0]),
+	           PROT_READ | PROT_WRITE,
+	           MAP_SHARED | MAP_ANONYMOUS,
+	           -1,
+	           0);
+	if (res == MAP_FAILED)
+		return -errno;
+
+	wrks = calloc(nr, sizeof(wrks[0]));
+	if (!wrks) {
+		err = -ENOMEM;
+		goto unmap;
+	}
+
+	for (w = 0; w < nr; w++) {
+		wrks[w].id = w;
+		wrks[w].path = path;
+		wrks[w].conf = conf;
+		wrks[w].load = load;
+		wrks[w].depot = depot;
+		wrks[w].store = store;
+		wrks[w].nr = conf->nr / nr;
+		wrks[w].res = &res[w];
+	}
+
+	/* Lock statistics are region wide, i.e. shared by all processes. */
+	err = kvs_get_depot_stats(depot, &dstats, KVS_STATS_CLEAR);
+	if (err)
+		goto free;
+
+	if (procs)
+		err = kvs_bench_scale_procs(wrks, nr, &secs);
+	else
+		err = kvs_bench_scale_threads(wrks, nr, &secs);
+
+	for (w = 0; !err && (w < nr); w++)
+		err = res[w].err;
+	if (err)
+		goto free;
+
+	err = kvs_get_depot_stats(depot, &dstats, 0);
+	if (err)
+		goto free;
+
+	kvs_bench_scale_report(conf, topo, load, nr, res, &dstats, secs);
+
+free:
+	free(wrks);
+unmap:
+	munmap(res, nr * sizeof(res[0]));
+
+	return err;
+}
+
+static int
+kvs_bench_scale_topo(const struct kvs_bench_conf *conf,
+                     const char                  *topo,
+                     unsigned int                 flags,
+                     bool                         procs)
+{
+	const struct kvs_depot_conf  dconf = { .cache_size = conf->cache };
+	struct kvs_depot             depot;
+	struct kvs_store             store;
+	char                        *path;
+	unsigned int                 l;
+	int                          err;
+
+	if (asprintf(&path, "%s/scale-%s", conf->path, topo) < 0)
+		return -ENOMEM;
+
+	err = kvs_open_depot_conf(&depot,
+	                          path,
+	                          KVS_BENCH_LOG_SIZE,
+	                          &dconf,
+	                          flags,
+	                          S_IRWXU);
+	if (err) {
+		kvs_bench_err("open scaling depot", err);
+		goto free;
+	}
+
+	err = kvs_strrec_open(&store,
+	                      &depot,
+	                      NULL,
+	                      "scale.db",
+	                      NULL,
+	                      S_IRWXU);
+	if (err) {
+		kvs_bench_err("open scaling store", err);
+		goto close_depot;
+	}
+
+	err = kvs_bench_fill_strrec(conf, &depot, &store, kvs_bench_rec_key);
+	if (err) {
+		kvs_bench_err("fill scaling store", err);
+		goto close_store;
+	}
+
+	for (l = 0;
+	     l < (sizeof(kvs_bench_scale_loads) /
+	          sizeof(kvs_bench_scale_loads[0]));
+	     l++) {
+		unsigned int nr;
+
+		for (nr = 1; nr <= conf->threads; nr *= 2) {
+			err = kvs_bench_scale_config(conf,
+			                             topo,
+			                             path,
+			                             &depot,
+			                             &store,
+			                             &kvs_bench_scale_loads[l],
+			                             nr,
+			                             procs);
+			if (err) {
+				kvs_bench_err("run scaling workload", err);
+				goto close_store;
+			}
+		}
+	}
+
+close_store:
+	kvs_strrec_close(&store);
+close_depot:
+	if (kvs_close_depot(&depot) && !err)
+		err = -EIO;
+free:
+	free(path);
+
+	return err;
+}
+
+static int
+kvs_bench_run_scale(const struct kvs_bench_conf *conf,
+                    const struct kvs_depot      *depot)
+{
+	int err;
+
+	/* Each topology runs into a depot of its own. */
+	(void)depot;
+
+	err = kvs_bench_scale_topo(conf, "thread", KVS_DEPOT_THREAD, false);
+	if (err)
+		return err;
+
+	return kvs_bench_scale_topo(conf, "process", 0, true);
+}
+
+/******************************************************************************
+ * Recovery benchmark
+ *
+ * For each maximum log file size, a child process fills a store then gets
+ * killed without closing anything, leaving the depot in need of recovery. The
+ * parent process then reopens the depot and reports startup phase durations.
+ ******************************************************************************/
+
+static const size_t kvs_bench_recover_logs[] = {
+	256U << 10,
+	1U << 20,
+	4U << 20,
+	16U << 20,
+	64U << 20
+};
+
+static void
+kvs_bench_recover_crash(const struct kvs_bench_conf *conf,
+                        const char                  *path,
+                        size_t                       log_size)
+{
+	/* Make commits survive process death without flushing the log. */
+	const struct kvs_depot_conf dconf = {
+		.cache_size = conf->cache,
+		.durability = KVS_XACT_WRITE_NOSYNC
+	};
+	struct kvs_depot            depot;
+	struct kvs_store            store;
+	int                         err;
+
+	err = kvs_open_depot_conf(&depot, path, log_size, &dconf, 0, S_IRWXU);
+	if (err) {
+		kvs_bench_err("open recovery depot", err);
+		_exit(EXIT_FAILURE);
+	}
+
+	err = kvs_strrec_open(&store,
+	                      &depot,
+	                      NULL,
+	                      "recover.db",
+	                      NULL,
+	                      S_IRWXU);
+	if (err) {
+		kvs_bench_err("open recovery store", err);
+		_exit(EXIT_FAILURE);
+	}
+
+	err = kvs_bench_fill_strrec(conf, &depot, &store, kvs_bench_rec_key);
+	if (err) {
+		kvs_bench_err("fill recovery store", err);
+		_exit(EXIT_FAILURE);
+	}
+
+	kill(getpid(), SIGKILL);
+
+	_exit(EXIT_FAILURE);
+}
+
+static void
+kvs_bench_recover_report(const struct kvs_bench_conf    *conf,
+                         size_t                          log_size,
+                         unsigned long long              open,
+                         const struct kvs_depot_startup *startup)
+{
+	if (conf->json) {
+		printf("{\"workload\":\"recover\","
+		       "\"log_size\":%zu,"
+		       "\"records\":%lu,"
+		       "\"open_us\":%llu,"
+		       "\"env_open_us\":%llu,"
+		       "\"ckpt_us\":%llu,"
+		       "\"store_open_us\":%llu}\n",
+		       log_size,
+		       conf->nr,
+		       open,
+		       startup->env_open,
+		       startup->ckpt,
+		       startup->store_open);
+		return;
+	}
+
+	printf("%-8s log=%-10zu records=%lu open=%lluus env_open=%lluus "
+	       "ckpt=%lluus store_open=%lluus\n",
+	       "recover",
+	       log_size,
+	       conf->nr,
+	       open,
+	       startup->env_open,
+	       startup->ckpt,
+	       startup->store_open);
+}
+
+static int
+kvs_bench_recover_log(const struct kvs_bench_conf *conf, size_t log_size)
+{
+	const struct kvs_depot_conf dconf = { .cache_size = conf->cache };
+	struct kvs_depot_startup    startup;
+	struct kvs_depot            depot;
+	struct kvs_store            store;
+	char                       *path;
+	pid_t                       pid;
+	int                         stat;
+	double                      start;
+	unsigned long long          open;
+	int                         err;
+
+	if (asprintf(&path, "%s/recover-%zu", conf->path, log_size) < 0)
+		return -ENOMEM;
+
+	fflush(NULL);
+	pid = fork();
+	if (pid < 0) {
+		err = -errno;
+		goto free;
+	}
+
+	if (!pid)
+		kvs_bench_recover_crash(conf, path, log_size);
+
+	while (waitpid(pid, &stat, 0) < 0) {
+		if (errno != EINTR) {
+			err = -errno;
+			goto free;
+		}
+	}
+
+	if (!WIFSIGNALED(stat) || (WTERMSIG(stat) != SIGKILL)) {
+		err = -ECHILD;
+		goto free;
+	}
+
+	start = kvs_bench_now();
+
+	err = kvs_open_depot_conf(&depot,
+	                          path,
+	                          log_size,
+	                          &dconf,
+	                          0,
+	                          S_IRWXU);
+	if (err) {
+		kvs_bench_err("recover depot", err);
+		goto free;
+	}
+
+	err = kvs_strrec_open(&store,
+	                      &depot,
+	                      NULL,
+	                      "recover.db",
+	                      NULL,
+	                      S_IRWXU);
+	if (err) {
+		kvs_bench_err("open recovered store", err);
+		goto close;
+	}
+
+	open = (unsigned long long)((kvs_bench_now() - start) * 1e6);
+	kvs_get_depot_startup(&depot, &startup);
+
+	kvs_bench_recover_report(conf, log_size, open, &startup);
+
+	kvs_strrec_close(&store);
+close:
+	if (kvs_close_depot(&depot) && !err)
+		err = -EIO;
+free:
+	free(path);
+
+	return err;
+}
+
+static int
+kvs_bench_run_recover(const struct kvs_bench_conf *conf,
+                      const struct kvs_depot      *depot)
+{
+	unsigned int l;
+	int          err;
+
+	/* Each log size runs into a depot of its own. */
+	(void)depot;
+
+	for (l = 0;
+	     l < (sizeof(kvs_bench_recover_logs) /
+	          sizeof(kvs_bench_recover_logs[0]));
+	     l++) {
+		err = kvs_bench_recover_log(conf, kvs_bench_recover_logs[l]);
+		if (err) {
+			kvs_bench_err("run recovery workload", err);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static const char *
+kvs_bench_type_name(unsigned int idx)
+{
+	return kvs_bench_types[idx].name;
+}
+
+static const char *
+kvs_bench_op_name(unsigned int idx)
+{
+	return kvs_bench_op_names[idx];
+}
+
+static const struct kvs_bench_commit_mode *
+kvs_bench_parse_mode(const char *arg)
+{
+	unsigned int m;
+
+	for (m = 0; m < KVS_BENCH_COMMIT_MODE_NR; m++)
+		if (!strcmp(arg, kvs_bench_commit_modes[m].name))
+			return &kvs_bench_commit_modes[m];
+
+	return NULL;
+}
+
+typedef const char * (kvs_bench_name_fn)(unsigned int idx);
+
+/* Parse a comma separated list of names into a bitmask of name indices. */
+static int
+kvs_bench_parse_list(const char        *arg,
+                     kvs_bench_name_fn *name,
+                     unsigned int       nr,
+                     unsigned int      *mask)
+{
+	char         *list;
+	char         *tok;
+	char         *save;
+	unsigned int  msk = 0;
+	int           err = 0;
+
+	list = strdup(arg);
+	if (!list)
+		return -ENOMEM;
+
+	for (tok = strtok_r(list, ",", &save);
+	     tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		unsigned int i;
+
+		for (i = 0; i < nr; i++)
+			if (!strcmp(tok, name(i)))
+				break;
+
+		if (i == nr) {
+			err = -EINVAL;
+			break;
+		}
+
+		msk |= 1U << i;
+	}
+
+	free(list);
+
+	if (err || !msk)
+		return -EINVAL;
+
+	*mask = msk;
+
+	return 0;
+}
+
+static const struct kvs_bench_workload kvs_bench_workloads[] = {
+	{ .name = "scan",     .run = kvs_bench_run_scan },
+	{ .name = "put",      .run = kvs_bench_run_put },
+	{ .name = "compress", .run = kvs_bench_run_compress },
+	{ .name = "commit",   .run = kvs_bench_run_commit },
+	{ .name = "isol",     .run = kvs_bench_run_isol },
+	{ .name = "xact",     .run = kvs_bench_run_xact },
+	{ .name = "suite",    .run = kvs_bench_run_suite },
+	{ .name = "scale",    .run = kvs_bench_run_scale },
+	{ .name = "recover",  .run = kvs_bench_run_recover }
+};
+
+#if defined(CONFIG_KVSTORE_LATENCY)
+
+static void
+kvs_bench_report_lat(void)
+{
+	static const char * const names[KVS_LAT_OP_NR] = {
+		[KVS_LAT_GET]    = "get",
+		[KVS_LAT_PGET]   = "pget",
+		[KVS_LAT_PUT]    = "put",
+		[KVS_LAT_DEL]    = "del",
+		[KVS_LAT_ITER]   = "iter",
+		[KVS_LAT_COMMIT] = "commit"
+	};
+	struct kvs_lat_hist              hist;
+	unsigned int                     op;
+
+	for (op = 0; op < KVS_LAT_OP_NR; op++) {
+		kvs_get_lat_hist(op, &hist);
+		if (!hist.count)
+			continue;
+
+		printf("%-8s %-8s ops=%llu avg=%lluns p50=%lluns p99=%lluns "
+		       "p99.9=%lluns\n",
+		       "latency",
+		       names[op],
+		       hist.count,
+		       hist.sum / hist.count,
+		       kvs_lat_hist_pct(&hist, 50),
+		       kvs_lat_hist_pct(&hist, 99),
+		       kvs_lat_hist_pct(&hist, 99.9));
+	}
+}
+
+#else  /* !defined(CONFIG_KVSTORE_LATENCY) */
+
+static void
+kvs_bench_report_lat(void)
+{
+}
+
+#endif /* defined(CONFIG_KVSTORE_LATENCY) */
+
+static void
+kvs_bench_usage(FILE *stdio)
+{
+	unsigned int w;
+
+	fprintf(stdio,
+	        "Usage: %s [OPTIONS] WORKLOAD\n"
+	        "Run kvstore benchmark WORKLOAD.\n"
+	        "\n"
+	        "With OPTIONS:\n"
+	        "    -d | --depot DIR   use depot located under DIR [%s]\n"
+	        "    -n | --records NR  operate onto NR records [%lu]\n"
+	        "    -s | --size SIZE   use items of SIZE bytes [%u]\n"
+	        "    -k | --key SIZE    use suite keys of SIZE bytes [%u]\n"
+	        "    -b | --bulk SIZE   use bulk buffers of SIZE bytes [%u]\n"
+	        "    -c | --cache SIZE  use a depot cache of SIZE bytes [default]\n"
+	        "    -t | --threads NR  run up to NR concurrent threads [%u]\n"
+	        "    -r | --read PCT    issue PCT%% of suite mixed reads [%u]\n"
+	        "    -D | --durability MODE\n"
+	        "                       use suite durability MODE [%s]\n"
+	        "    -T | --types LIST  run suite over TYPE LIST [all]\n"
+	        "    -O | --ops LIST    run suite OP LIST [all]\n"
+	        "    -j | --json        report suite results as JSON lines\n"
+	        "    -h | --help        this help message\n"
+	        "\n"
+	        "With WORKLOAD:\n",
+	        kvs_bench_argv0,
+	        KVS_BENCH_PATH,
+	        KVS_BENCH_NR,
+	        KVS_BENCH_SIZE,
+	        KVS_BENCH_KEY_SIZE,
+	        KVS_ITER_BULK_SIZE,
+	        KVS_BENCH_THREAD_NR,
+	        KVS_BENCH_READ_PCT,
+	        kvs_bench_commit_modes[0].name);
+
+	for (w = 0;
+	     w < (sizeof(kvs_bench_workloads) / sizeof(kvs_bench_workloads[0]));
+	     w++)
+		fprintf(stdio, "    %s\n", kvs_bench_workloads[w].name);
+
+	fprintf(stdio, "\nWith MODE:\n");
+	for (w = 0; w < KVS_BENCH_COMMIT_MODE_NR; w++)
+		fprintf(stdio, "    %s\n", kvs_bench_commit_modes[w].name);
+
+	fprintf(stdio, "\nWith TYPE:\n");
+	for (w = 0; w < KVS_BENCH_TYPE_NR; w++)
+		fprintf(stdio, "    %s\n", kvs_bench_types[w].name);
+
+	fprintf(stdio,
+	        "\nWith OP:\n"
+	        "    load   insert records by batches\n"
+	        "    get    lookup random records\n"
+	        "    put    update random records\n"
+	        "    scan   iterate over all records from each thread\n"
+	        "    mixed  lookup or update random records\n"
+	        "    del    delete all records\n"
+	        "\n"
+	        "LIST is a comma separated list of names. table TYPE\n"
+	        "requires items of at least %u bytes. file TYPE supports\n"
+	        "load, get, put and mixed OPs only.\n",
+	        KVS_BENCH_FIELD_SIZE);
+}
+
+int main(int argc, char * const argv[])
+{
+	static const struct option        opts[] = {
+		{ "depot",      required_argument, NULL, 'd' },
+		{ "records",    required_argument, NULL, 'n' },
+		{ "size",       required_argument, NULL, 's' },
+		{ "key",        required_argument, NULL, 'k' },
+		{ "bulk",       required_argument, NULL, 'b' },
+		{ "cache",      required_argument, NULL, 'c' },
+		{ "threads",    required_argument, NULL, 't' },
+		{ "read",       required_argument, NULL, 'r' },
+		{ "durability", required_argument, NULL, 'D' },
+		{ "types",      required_argument, NULL, 'T' },
+		{ "ops",        required_argument, NULL, 'O' },
+		{ "json",       no_argument,       NULL, 'j' },
+		{ "help",       no_argument,       NULL, 'h' },
+		{ NULL,         0,                 NULL, 0 }
+	};
+	struct kvs_bench_conf             conf = {
+		.path     = KVS_BENCH_PATH,
+		.nr       = KVS_BENCH_NR,
+		.size     = KVS_BENCH_SIZE,
+		.key_size = KVS_BENCH_KEY_SIZE,
+		.bulk     = KVS_ITER_BULK_SIZE,
+		.threads  = KVS_BENCH_THREAD_NR,
+		.ratio    = KVS_BENCH_READ_PCT,
+		.mode     = &kvs_bench_commit_modes[0],
+		.types    = (1U << KVS_BENCH_TYPE_NR) - 1,
+		.ops      = (1U << KVS_BENCH_OP_NR) - 1
+	};
+	const struct kvs_bench_workload  *wkld = NULL;
+	struct kvs_depot_conf             dconf = { 0, };
+	struct kvs_depot                  depot;
+	unsigned int                      w;
+	int                               err;
+
+	kvs_bench_argv0 = basename(argv[0]);
+
+	while (true) {
+		int opt = getopt_long(argc,
+		                      argv,
+		                      "d:n:s:k:b:c:t:r:D:T:O:jh",
+		                      opts,
+		                      NULL);
+
+		if (opt < 0)
+			break;
+
+		switch (opt) {
+		case 'd':
+			conf.path = optarg;
+			break;
+		case 'n':
+			conf.nr = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			conf.size = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			conf.key_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			conf.bulk = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			conf.cache = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			conf.threads = (unsigned int)strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			conf.ratio = (unsigned int)strtoul(optarg, NULL, 0);
+			break;
+		case 'D':
+			conf.mode = kvs_bench_parse_mode(optarg);
+			if (!conf.mode) {
+				kvs_bench_usage(stderr);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'T':
+			if (kvs_bench_parse_list(optarg,
+			                         kvs_bench_type_name,
+			                         KVS_BENCH_TYPE_NR,
+			                         &conf.types)) {
+				kvs_bench_usage(stderr);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'O':
+			if (kvs_bench_parse_list(optarg,
+			                         kvs_bench_op_name,
+			                         KVS_BENCH_OP_NR,
+			                         &conf.ops)) {
+				kvs_bench_usage(stderr);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'j':
+			conf.json = true;
+			break;
+		case 'h':
+			kvs_bench_usage(stdout);
+			return EXIT_SUCCESS;
+		default:
+			kvs_bench_usage(stderr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if ((argc - optind) != 1) {
+		kvs_bench_usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	for (w = 0;
+	     w < (sizeof(kvs_bench_workloads) / sizeof(kvs_bench_workloads[0]));
+	     w++) {
+		if (!strcmp(argv[optind], kvs_bench_workloads[w].name)) {
+			wkld = &kvs_bench_workloads[w];
+			break;
+		}
+	}
+
+	if (!wkld || !conf.nr || !conf.size || !conf.key_size ||
+	    !conf.threads || (conf.ratio > 100)) {
+		kvs_bench_usage(stderr);
+		return EXIT_FAILURE;
+	}
+
+	kvs_enable_verb(KVS_VERB_OUT, KVS_VERB_ERR_PREFIX, KVS_VERB_QUIET);
+
+	dconf.cache_size = conf.cache;
+	err = kvs_open_depot_conf(&depot,
+	                          conf.path,
+	                          KVS_BENCH_LOG_SIZE,
+	                          &dconf,
+	                          0,
+	                          S_IRWXU);
+	if (err) {
+		kvs_bench_err("open depot", err);
+		return EXIT_FAILURE;
+	}
+
+	err = wkld->run(&conf, &depot);
+	if (!err)
+		kvs_bench_report_lat();
+
+	if (kvs_close_depot(&depot) && !err)
+		err = -EIO;
+
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -4,6 +4,8 @@
 #include "kvstore/config.h"
 #include <kvstore/store.h>
 #include <utils/cdefs.h>
+#include <pthread.h>
+#include <time.h>
 
 #if defined(CONFIG_KVSTORE_DEBUG)
 
@@ -21,14 +23,174 @@ kvs_env_dbg(DB_ENV *env __unused, const char *fmt __unused, ...)
 
 #endif /* defined(CONFIG_KVSTORE_DEBUG) */
 
+struct kvs_maint;
+
+/*
+ * Depot private state.
+ *
+ * Group commit: sync_req counts synchronous commit requests, sync_done the
+ * number of them already made durable. A committer waiting for its request to
+ * be made durable either becomes the flushing leader when no flush is in
+ * progress or waits for the current leader to complete.
+ *
+ * Deadlock detection: when detect_period is non zero, detect_thread runs
+ * deadlock detection using the detect policy every detect_period milliseconds
+ * until detect_stop is set. detect_nr counts lock requests it rejected.
+ *
+ * xact_stats: transaction runner counters (see kvs_run_xact()).
+ *
+ * maint: background maintenance thread state, NULL when not running.
+ *
+ * startup: opening phase durations (see kvs_get_depot_startup()).
+ *
+ * fast_open: leave a clean shutdown marker behind at closing time.
+ */
+struct kvs_depot_priv {
+	unsigned int              durability;
+	bool                      group;
+	pthread_mutex_t           sync_lock;
+	pthread_cond_t            sync_cond;
+	bool                      syncing;
+	unsigned long             sync_req;
+	unsigned long             sync_done;
+	unsigned int              detect;
+	unsigned int              detect_period;
+	pthread_t                 detect_thread;
+	pthread_mutex_t           detect_lock;
+	pthread_cond_t            detect_cond;
+	bool                      detect_stop;
+	unsigned long             detect_nr;
+	struct kvs_xact_stats     xact_stats;
+	struct kvs_maint         *maint;
+	struct kvs_depot_startup  startup;
+	bool                      fast_open;
+};
+
+static inline unsigned long long
+kvs_now_usec(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((unsigned long long)now.tv_sec * 1000000ULL) +
+	       ((unsigned long long)now.tv_nsec / 1000ULL);
+}
+
+/* Condition variables timed waits use the monotonic clock. */
+extern void
+kvs_init_clock_cond(pthread_cond_t *cond);
+
+extern void
+kvs_clock_deadline(struct timespec *tspec, unsigned int msec);
+
 #define kvs_assert_depot(_depot) \
 	kvs_assert(_depot); \
 	kvs_assert((_depot)->env); \
+	kvs_assert((_depot)->priv); \
 	kvs_assert(!((_depot)->flags & ~(KVS_DEPOT_THREAD | KVS_DEPOT_MVCC)));
 
+#define KVS_XACT_DURABILITY \
+	(KVS_XACT_SYNC | KVS_XACT_WRITE_NOSYNC | KVS_XACT_NOSYNC)
+
+#define kvs_assert_durability(_flags) \
+	kvs_assert(!((_flags) & ~KVS_XACT_DURABILITY)); \
+	kvs_assert(((_flags) == 0) || \
+	           ((_flags) == KVS_XACT_SYNC) || \
+	           ((_flags) == KVS_XACT_WRITE_NOSYNC) || \
+	           ((_flags) == KVS_XACT_NOSYNC))
+
+#define KVS_XACT_ISOLATION \
+	(KVS_XACT_SNAPSHOT | KVS_XACT_READ_COMMITTED | KVS_XACT_READ_UNCOMMITTED)
+
+#define kvs_assert_isolation(_flags) \
+	kvs_assert(!((_flags) & ~KVS_XACT_ISOLATION)); \
+	kvs_assert(((_flags) == 0) || \
+	           ((_flags) == KVS_XACT_SNAPSHOT) || \
+	           ((_flags) == KVS_XACT_READ_COMMITTED) || \
+	           ((_flags) == KVS_XACT_READ_UNCOMMITTED))
+
 #define kvs_assert_xact(_xact) \
 	kvs_assert(_xact); \
-	kvs_assert((_xact)->txn)
+	kvs_assert((_xact)->txn); \
+	kvs_assert((_xact)->depot)
+
+#if defined(CONFIG_KVSTORE_SDT)
+
+#include <sys/sdt.h>
+
+/*
+ * Statically defined tracepoints (USDT) of the "kvstore" provider, e.g. to be
+ * enabled with "perf probe sdt_kvstore:<name>" or bpftrace "usdt" probes.
+ * Arguments should remain cheap to compute: they are evaluated whether the
+ * probe is enabled or not.
+ */
+#define kvs_probe(_name, ...) \
+	STAP_PROBEV(kvstore, _name, ##__VA_ARGS__)
+
+#else  /* !defined(CONFIG_KVSTORE_SDT) */
+
+#define kvs_probe(_name, ...) \
+	do { } while (0)
+
+#endif /* defined(CONFIG_KVSTORE_SDT) */
+
+#if defined(CONFIG_KVSTORE_LATENCY)
+
+extern unsigned long long
+kvs_lat_now(void);
+
+extern void
+kvs_lat_record(enum kvs_lat_op op, unsigned long long start);
+
+#else  /* !defined(CONFIG_KVSTORE_LATENCY) */
+
+#define KVS_LAT_GET    (0)
+#define KVS_LAT_PGET   (0)
+#define KVS_LAT_PUT    (0)
+#define KVS_LAT_DEL    (0)
+#define KVS_LAT_ITER   (0)
+#define KVS_LAT_COMMIT (0)
+
+static inline unsigned long long
+kvs_lat_now(void)
+{
+	return 0;
+}
+
+static inline void
+kvs_lat_record(int op __unused, unsigned long long start __unused)
+{
+}
+
+#endif /* defined(CONFIG_KVSTORE_LATENCY) */
+
+struct kvs_attr_pend;
+
+#if defined(CONFIG_KVSTORE_ATTR_CACHE)
+
+/* Attribute read cache entries pending on outermost transactions resolution. */
+extern struct kvs_attr_pend *
+kvs_attr_detach_cache(DB_TXN *txn);
+
+extern void
+kvs_attr_release_cache(struct kvs_attr_pend *list, bool invalidate);
+
+#else  /* !defined(CONFIG_KVSTORE_ATTR_CACHE) */
+
+static inline struct kvs_attr_pend *
+kvs_attr_detach_cache(DB_TXN *txn __unused)
+{
+	return NULL;
+}
+
+static inline void
+kvs_attr_release_cache(struct kvs_attr_pend *list __unused,
+                       bool                  invalidate __unused)
+{
+}
+
+#endif /* defined(CONFIG_KVSTORE_ATTR_CACHE) */
 
 #define KVS_STR_MAX (4096U)
 
@@ -58,6 +220,19 @@ kvs_serialize_strpile(const struct upile *pile, void **data);
 		0, \
 	}
 
+typedef int (kvs_iter_goto_fn)(const struct kvs_iter *iter,
+                               DBT                   *key,
+                               DBT                   *item);
+
+typedef int (kvs_iter_pgoto_fn)(const struct kvs_iter *iter,
+                                DBT                   *skey,
+                                DBT                   *pkey,
+                                DBT                   *item);
+
+typedef int (kvs_iter_dups_fn)(const struct kvs_iter *iter,
+                               DBT                   *pkey,
+                               DBT                   *item);
+
 extern int
 kvs_iter_goto_first(const struct kvs_iter *iter, DBT *key, DBT *item);
 
@@ -70,11 +245,69 @@ kvs_iter_goto_last(const struct kvs_iter *iter, DBT *key, DBT *item);
 extern int
 kvs_iter_goto_prev(const struct kvs_iter *iter, DBT *key, DBT *item);
 
+extern int
+kvs_iter_goto_seek(const struct kvs_iter *iter, DBT *key, DBT *item);
+
+extern int
+kvs_iter_pgoto_first(const struct kvs_iter *iter,
+                     DBT                   *skey,
+                     DBT                   *pkey,
+                     DBT                   *item);
+
+extern int
+kvs_iter_pgoto_next(const struct kvs_iter *iter,
+                    DBT                   *skey,
+                    DBT                   *pkey,
+                    DBT                   *item);
+
+extern int
+kvs_iter_pgoto_last(const struct kvs_iter *iter,
+                    DBT                   *skey,
+                    DBT                   *pkey,
+                    DBT                   *item);
+
+extern int
+kvs_iter_pgoto_prev(const struct kvs_iter *iter,
+                    DBT                   *skey,
+                    DBT                   *pkey,
+                    DBT                   *item);
+
+extern int
+kvs_iter_pgoto_seek(const struct kvs_iter *iter,
+                    DBT                   *skey,
+                    DBT                   *pkey,
+                    DBT                   *item);
+
 extern int
 kvs_init_iter(const struct kvs_store *store,
               const struct kvs_xact  *xact,
               struct kvs_iter        *iter);
 
+extern int
+kvs_init_range_iter(const struct kvs_store *store,
+                    const struct kvs_xact  *xact,
+                    struct kvs_iter        *iter,
+                    const struct kvs_range *range);
+
+extern int
+kvs_init_bulk_iter(const struct kvs_store *store,
+                   const struct kvs_xact  *xact,
+                   struct kvs_iter        *iter,
+                   size_t                  size);
+
+extern int
+kvs_init_dups_iter(const struct kvs_store *index,
+                   const struct kvs_xact  *xact,
+                   struct kvs_iter        *iter,
+                   const DBT              *skey,
+                   size_t                  size);
+
+extern int
+kvs_iter_dups_first(const struct kvs_iter *iter, DBT *pkey, DBT *item);
+
+extern int
+kvs_iter_dups_next(const struct kvs_iter *iter, DBT *pkey, DBT *item);
+
 extern int
 kvs_fini_iter(const struct kvs_iter *iter);
 
@@ -85,6 +318,13 @@ kvs_get(const struct kvs_store *store,
         DBT                    *item,
         unsigned int            flags);
 
+extern int
+kvs_get_into(const struct kvs_store *store,
+             const struct kvs_xact  *xact,
+             DBT                    *key,
+             void                   *data,
+             size_t                 *size);
+
 extern int
 kvs_pget(const struct kvs_store *index,
          const struct kvs_xact  *xact,
@@ -105,18 +345,59 @@ kvs_del(const struct kvs_store *store,
         const struct kvs_xact  *xact,
         DBT                    *key);
 
+/*
+ * Size of bulk buffers holding nr keys (or items), nr key / item pairs and nr
+ * record number / item pairs respectively, where data sum up to size bytes.
+ */
+#define KVS_BULK_SIZE(_nr, _size) \
+	((_size) + ((2 * (_nr)) + 1) * sizeof(u_int32_t))
+
+#define KVS_BULK_KEY_SIZE(_nr, _size) \
+	((_size) + ((4 * (_nr)) + 1) * sizeof(u_int32_t))
+
+#define KVS_BULK_RECNO_SIZE(_nr, _size) \
+	((_size) + ((3 * (_nr)) + 1) * sizeof(u_int32_t))
+
+extern int
+kvs_init_bulk(DBT *bulk, size_t size, void **ptr);
+
+extern void
+kvs_fini_bulk(const DBT *bulk);
+
 extern int
-kvs_open_store(struct kvs_store       *store,
-               const struct kvs_depot *depot,
-               const struct kvs_xact  *xact,
-               const char             *path,
-               const char             *name,
-               DBTYPE                  type,
-               mode_t                  mode);
+kvs_put_bulk(const struct kvs_store *store,
+             const struct kvs_xact  *xact,
+             DBT                    *bulk);
+
+extern int
+kvs_del_bulk(const struct kvs_store *store,
+             const struct kvs_xact  *xact,
+             DBT                    *bulk);
+
+extern int
+kvs_open_store(struct kvs_store            *store,
+               const struct kvs_depot      *depot,
+               const struct kvs_xact       *xact,
+               const char                  *path,
+               const char                  *name,
+               DBTYPE                       type,
+               const struct kvs_store_conf *conf,
+               mode_t                       mode);
 
 extern int
 kvs_close_store(const struct kvs_store *store);
 
+extern int
+kvs_associate_indx(struct kvs_store            *indx,
+                   const struct kvs_store      *store,
+                   const struct kvs_depot      *depot,
+                   const struct kvs_xact       *xact,
+                   const char                  *path,
+                   const char                  *name,
+                   const struct kvs_store_conf *conf,
+                   kvs_bind_indx_fn            *bind,
+                   unsigned int                 flags);
+
 #if defined(CONFIG_KVSTORE_LOG)
 
 #if defined(CONFIG_KVSTORE_DEBUG)
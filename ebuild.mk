@@ -10,10 +10,13 @@ libkvstore.so-objs    += $(call kconf_enabled,KVSTORE_STRREC,strrec.o)
 libkvstore.so-objs    += $(call kconf_enabled,KVSTORE_AUTOREC,autorec.o)
 libkvstore.so-objs    += $(call kconf_enabled,KVSTORE_TABLE,table.o)
 libkvstore.so-objs    += $(call kconf_enabled,KVSTORE_REPO,repo.o)
+libkvstore.so-objs    += $(call kconf_enabled,KVSTORE_INDX_BUILD,indx.o)
+libkvstore.so-objs    += $(call kconf_enabled,KVSTORE_MAINT,maint.o)
+libkvstore.so-objs    += $(call kconf_enabled,KVSTORE_LATENCY,latency.o)
 libkvstore.so-cflags  := $(EXTRA_CFLAGS) -Wall -Wextra -D_GNU_SOURCE -DPIC -fpic
 libkvstore.so-ldflags  = $(EXTRA_LDFLAGS) \
                          -shared -fpic -Wl,-soname,libkvstore.so \
-                         -ldb
+                         -ldb -lpthread
 libkvstore.so-pkgconf  = $(call kconf_enabled,KVSTORE_ASSERT,libutils)
 libkvstore.so-pkgconf += $(call kconf_enabled,KVSTORE_FILE,libutils)
 libkvstore.so-pkgconf += $(call kconf_enabled,KVSTORE_LOG,libstroll)
@@ -33,6 +36,12 @@ kvs_test-cflags       := $(EXTRA_CFLAGS) -Wall -Wextra -D_GNU_SOURCE
 kvs_test-ldflags      := $(EXTRA_LDFLAGS) -lkvstore
 kvs_test-pkgconf       = $(call kconf_enabled,KVSTORE_BTRACE,libbtrace)
 
+bins                  += $(call kconf_enabled,KVSTORE_STRREC,kvs_bench)
+kvs_bench-objs        := bench.o
+kvs_bench-cflags      := $(EXTRA_CFLAGS) -Wall -Wextra -D_GNU_SOURCE
+kvs_bench-ldflags     := $(EXTRA_LDFLAGS) -lkvstore -lpthread
+kvs_bench-pkgconf     := libutils
+
 define libkvstore_pkgconf_tmpl
 prefix=$(PREFIX)
 exec_prefix=$${prefix}
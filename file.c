@@ -265,6 +265,12 @@ kvs_file_handle_log_rec(DB_ENV    *env,
 		                log_rec->orig.size,
 		                log_rec->new.size);
 
+		kvs_probe(file_recover_entry,
+		          op,
+		          (char *)log_rec->path.data,
+		          lsn->file,
+		          lsn->offset);
+
 		switch (op) {
 		case DB_TXN_ABORT:
 		case DB_TXN_BACKWARD_ROLL:
@@ -315,6 +321,11 @@ kvs_file_handle_log_rec(DB_ENV    *env,
 		 */
 		*lsn = log_rec->rec.prev;
 
+		kvs_probe(file_recover_return,
+		          op,
+		          (char *)log_rec->path.data,
+		          ret);
+
 		free(log_rec);
 
 		if (ret)
@@ -39,14 +39,35 @@ extern int
 kvs_attr_iter_next(const struct kvs_iter     *iter,
                    struct kvs_attr_iter_elem *elem);
 
+extern int
+kvs_attr_iter_last(const struct kvs_iter     *iter,
+                   struct kvs_attr_iter_elem *elem);
+
+extern int
+kvs_attr_iter_prev(const struct kvs_iter     *iter,
+                   struct kvs_attr_iter_elem *elem);
+
 extern int
 kvs_attr_init_iter(const struct kvs_store *store,
                    const struct kvs_xact  *xact,
                    struct kvs_iter        *iter);
 
+extern int
+kvs_attr_init_bulk_iter(const struct kvs_store *store,
+                        const struct kvs_xact  *xact,
+                        struct kvs_iter        *iter,
+                        size_t                  size);
+
 extern int
 kvs_attr_fini_iter(const struct kvs_iter *iter);
 
+extern int
+kvs_attr_load_data(const struct kvs_store *store,
+                   const struct kvs_xact  *xact,
+                   unsigned int            attr_id,
+                   void                   *data,
+                   size_t                 *size);
+
 extern int
 kvs_attr_store_num(const struct kvs_store *store,
                    const struct kvs_xact  *xact,
@@ -59,6 +80,28 @@ kvs_attr_clear(const struct kvs_store *store,
                const struct kvs_xact  *xact,
                unsigned int            attr_id);
 
+extern int
+kvs_attr_store_batch(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const unsigned int     *attr_ids,
+                     const struct kvs_chunk *values,
+                     unsigned int            nr);
+
+extern int
+kvs_attr_clear_batch(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const unsigned int     *attr_ids,
+                     unsigned int            nr);
+
+extern int
+kvs_attr_open_conf(struct kvs_store            *store,
+                   const struct kvs_depot      *depot,
+                   const struct kvs_xact       *xact,
+                   const char                  *path,
+                   const char                  *name,
+                   const struct kvs_store_conf *conf,
+                   mode_t                       mode);
+
 extern int
 kvs_attr_open(struct kvs_store       *store,
               const struct kvs_depot *depot,
@@ -70,6 +113,35 @@ kvs_attr_open(struct kvs_store       *store,
 extern int
 kvs_attr_close(const struct kvs_store *store);
 
+#if defined(CONFIG_KVSTORE_ATTR_CACHE)
+
+/*
+ * Attribute read cache.
+ *
+ * Once enabled onto an opened attribute store, values of attributes which
+ * identifier is lower than nr and size does not exceed KVS_ATTR_CACHE_SIZE_MAX
+ * bytes are kept into process memory so that further loads are served without
+ * calling into libdb. Cached values are invalidated when the outermost
+ * transaction updating them commits and kept as is when it is rolled back.
+ *
+ * Cached loads return the last committed value, i.e. with read committed
+ * isolation and without locking ; snapshot transactions always bypass the
+ * cache. Since invalidation happens in process, all writers of the store must
+ * run within the current process.
+ *
+ * Cache is released at kvs_attr_close() time. It must not be disabled while
+ * transactions are using the store.
+ */
+#define KVS_ATTR_CACHE_SIZE_MAX (32U)
+
+extern int
+kvs_attr_enable_cache(const struct kvs_store *store, unsigned int nr);
+
+extern void
+kvs_attr_disable_cache(const struct kvs_store *store);
+
+#endif /* defined(CONFIG_KVSTORE_ATTR_CACHE) */
+
 /******************************************************************************
  * String attribute handling
  ******************************************************************************/
@@ -31,11 +31,80 @@ kvs_autorec_iter_next(const struct kvs_iter *iter,
                       uint64_t              *id,
                       struct kvs_chunk      *item);
 
+extern int
+kvs_autorec_iter_last(const struct kvs_iter *iter,
+                      uint64_t              *id,
+                      struct kvs_chunk      *item);
+
+extern int
+kvs_autorec_iter_prev(const struct kvs_iter *iter,
+                      uint64_t              *id,
+                      struct kvs_chunk      *item);
+
+extern int
+kvs_autorec_field_iter_first(const struct kvs_iter *iter,
+                             struct kvs_chunk      *field,
+                             uint64_t              *id,
+                             struct kvs_chunk      *item);
+
+extern int
+kvs_autorec_field_iter_next(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            uint64_t              *id,
+                            struct kvs_chunk      *item);
+
+extern int
+kvs_autorec_field_iter_last(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            uint64_t              *id,
+                            struct kvs_chunk      *item);
+
+extern int
+kvs_autorec_field_iter_prev(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            uint64_t              *id,
+                            struct kvs_chunk      *item);
+
+extern int
+kvs_autorec_field_iter_seek(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            uint64_t              *id,
+                            struct kvs_chunk      *item);
+
+extern int
+kvs_autorec_iter_byfield_first(const struct kvs_iter *iter,
+                               uint64_t              *id,
+                               struct kvs_chunk      *item);
+
+extern int
+kvs_autorec_iter_byfield_next(const struct kvs_iter *iter,
+                              uint64_t              *id,
+                              struct kvs_chunk      *item);
+
 extern int
 kvs_autorec_init_iter(const struct kvs_store *store,
                       const struct kvs_xact  *xact,
                       struct kvs_iter        *iter);
 
+extern int
+kvs_autorec_init_bulk_iter(const struct kvs_store *store,
+                           const struct kvs_xact  *xact,
+                           struct kvs_iter        *iter,
+                           size_t                  size);
+
+extern int
+kvs_autorec_init_field_iter(const struct kvs_store *index,
+                            const struct kvs_xact  *xact,
+                            struct kvs_iter        *iter,
+                            const struct kvs_range *range);
+
+extern int
+kvs_autorec_init_byfield_iter(const struct kvs_store *index,
+                              const struct kvs_xact  *xact,
+                              struct kvs_iter        *iter,
+                              const struct kvs_chunk *field,
+                              size_t                  size);
+
 extern int
 kvs_autorec_fini_iter(const struct kvs_iter *iter);
 
@@ -45,6 +114,13 @@ kvs_autorec_get_byid(const struct kvs_store *store,
                      uint64_t                id,
                      struct kvs_chunk       *item);
 
+extern int
+kvs_autorec_load_byid(const struct kvs_store *store,
+                      const struct kvs_xact  *xact,
+                      uint64_t                id,
+                      void                   *data,
+                      size_t                 *size);
+
 extern int
 kvs_autorec_get_byfield(const struct kvs_store *index,
                         const struct kvs_xact  *xact,
@@ -58,6 +134,13 @@ kvs_autorec_add(const struct kvs_store *store,
                 uint64_t               *id,
                 const struct kvs_chunk *item);
 
+extern int
+kvs_autorec_add_batch(const struct kvs_store *store,
+                      const struct kvs_xact  *xact,
+                      uint64_t               *ids,
+                      const struct kvs_chunk *items,
+                      unsigned int            nr);
+
 extern int
 kvs_autorec_update(const struct kvs_store *store,
                    const struct kvs_xact  *xact,
@@ -69,11 +152,25 @@ kvs_autorec_del_byid(const struct kvs_store *store,
                      const struct kvs_xact  *xact,
                      uint64_t                id);
 
+extern int
+kvs_autorec_del_batch(const struct kvs_store *store,
+                      const struct kvs_xact  *xact,
+                      const uint64_t         *ids,
+                      unsigned int            nr);
+
 extern int
 kvs_autorec_del_byfield(const struct kvs_store *index,
                         const struct kvs_xact  *xact,
                         const struct kvs_chunk *field);
 
+extern int
+kvs_autorec_open_conf(struct kvs_store            *store,
+                      const struct kvs_depot      *depot,
+                      const struct kvs_xact       *xact,
+                      const char                  *path,
+                      const struct kvs_store_conf *conf,
+                      mode_t                       mode);
+
 extern int
 kvs_autorec_open(struct kvs_store       *store,
                  const struct kvs_depot *depot,
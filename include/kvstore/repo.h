@@ -43,6 +43,14 @@ kvs_repo_get_table(const struct kvs_repo *repo, unsigned int tbl_id)
 	return &repo->tables[tbl_id];
 }
 
+extern int
+kvs_repo_open_conf(struct kvs_repo             *repo,
+                   const char                  *path,
+                   size_t                       max_log,
+                   const struct kvs_depot_conf *conf,
+                   unsigned int                 flags,
+                   mode_t                       mode);
+
 extern int
 kvs_repo_open(struct kvs_repo *repo,
               const char      *path,
@@ -3,7 +3,10 @@
 
 #include <kvstore/config.h>
 #include <db.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 /******************************************************************************
  * Global kvstore library routines.
@@ -42,15 +45,105 @@ kvs_strerror(int err);
  * Depot handling.
  ******************************************************************************/
 
+struct kvs_depot_priv;
+
 struct kvs_depot {
-	DB_ENV       *env;
-	unsigned int  flags;
+	DB_ENV                *env;
+	unsigned int           flags;
+	struct kvs_depot_priv *priv;
 };
 
 #define KVS_DEPOT_PRIV   (DB_PRIVATE)
 #define KVS_DEPOT_THREAD (DB_THREAD)
 #define KVS_DEPOT_MVCC   (DB_MULTIVERSION)
 
+/*
+ * Depot memory configuration.
+ *
+ * cache_size: total size of the shared memory buffer pool (mpool) in bytes,
+ *             split into cache_nr regions (0 means a single region) ;
+ * mmap_size:  maximum size of read-only store files mapped in memory instead
+ *             of being loaded into the buffer pool ;
+ * max_mem:    upper bound of memory allocated for all depot regions, buffer
+ *             pool included.
+ *
+ * A zero value keeps the corresponding libdb default.
+ * See https://docs.oracle.com/database/bdb181/html/programmer_reference/general_am_conf.html#am_conf_cachesize
+ *
+ * Depot commit durability.
+ *
+ * durability:   default durability of transaction commits, i.e. one of
+ *               KVS_XACT_SYNC (the default), KVS_XACT_WRITE_NOSYNC or
+ *               KVS_XACT_NOSYNC (see kvs_begin_xact()) ;
+ * group_commit: when true, concurrent synchronous commits share log flushes:
+ *               each committer writes its commit record without flushing,
+ *               then a single one of them flushes the log on behalf of all
+ *               others waiting at that time.
+ *
+ * Depot lock conflict handling.
+ *
+ * detect:        deadlock detection policy, i.e. how to select the transaction
+ *                to abort when breaking a deadlock (one of KVS_DETECT_*, 0
+ *                means KVS_DETECT_DEFAULT) ;
+ * detect_period: when non zero, deadlock detection is no longer run each time
+ *                a lock request blocks but every detect_period milliseconds by
+ *                a background thread instead, keeping detection cost out of
+ *                conflicting writers path (requires KVS_DEPOT_THREAD) ;
+ * lock_timeout:  default maximum time in microseconds a lock request may be
+ *                blocked (0 means no timeout) ;
+ * xact_timeout:  default maximum lifetime of transactions in microseconds (0
+ *                means no timeout).
+ *
+ * Transactions aborted to break a deadlock fail with DB_LOCK_DEADLOCK whereas
+ * those exceeding a timeout fail with DB_LOCK_NOTGRANTED. Timeouts are checked
+ * when a lock request blocks and at deadlock detection time.
+ *
+ * Depot restart.
+ *
+ * fast_open: when true, a marker is left into depot directory once closed
+ *            cleanly so that next opening may skip recovery. Recovery is still
+ *            run when marker is missing or when libdb detects that a process
+ *            sharing the depot died ;
+ * failchk:   when non zero, maximum number of threads of control (threads of
+ *            all processes) concurrently using the depot. Enables tracking of
+ *            threads of control so that resources left behind by dead
+ *            processes may be released by surviving ones instead of running
+ *            full recovery (see kvs_check_depot()). Requires a depot shared
+ *            between processes, i.e. opened without KVS_DEPOT_PRIV.
+ */
+#define KVS_DETECT_DEFAULT  (DB_LOCK_DEFAULT)
+#define KVS_DETECT_EXPIRE   (DB_LOCK_EXPIRE)
+#define KVS_DETECT_MAXLOCKS (DB_LOCK_MAXLOCKS)
+#define KVS_DETECT_MAXWRITE (DB_LOCK_MAXWRITE)
+#define KVS_DETECT_MINLOCKS (DB_LOCK_MINLOCKS)
+#define KVS_DETECT_MINWRITE (DB_LOCK_MINWRITE)
+#define KVS_DETECT_OLDEST   (DB_LOCK_OLDEST)
+#define KVS_DETECT_RANDOM   (DB_LOCK_RANDOM)
+#define KVS_DETECT_YOUNGEST (DB_LOCK_YOUNGEST)
+
+struct kvs_depot_conf {
+	size_t       cache_size;
+	unsigned int cache_nr;
+	size_t       mmap_size;
+	size_t       max_mem;
+	unsigned int durability;
+	bool         group_commit;
+	unsigned int detect;
+	unsigned int detect_period;
+	unsigned int lock_timeout;
+	unsigned int xact_timeout;
+	bool         fast_open;
+	unsigned int failchk;
+};
+
+extern int
+kvs_open_depot_conf(struct kvs_depot            *depot,
+                    const char                  *path,
+                    size_t                       max_log_size,
+                    const struct kvs_depot_conf *conf,
+                    unsigned int                 flags,
+                    mode_t                       mode);
+
 extern int
 kvs_open_depot(struct kvs_depot *depot,
                const char       *path,
@@ -58,18 +151,297 @@ kvs_open_depot(struct kvs_depot *depot,
                unsigned int      flags,
                mode_t            mode);
 
+/*
+ * Retrieve configuration in effect for an opened depot, i.e. once libdb
+ * applied its own adjustments (minimum sizes, overhead, rounding...).
+ */
+extern int
+kvs_get_depot_conf(const struct kvs_depot *depot, struct kvs_depot_conf *conf);
+
 extern int
 kvs_close_depot(const struct kvs_depot *depot);
 
+/*
+ * Release locks and transactions left behind by dead processes sharing depot.
+ *
+ * Depot must have been opened with failchk enabled (see struct kvs_depot_conf).
+ * This is also performed when opening depot. Returns DB_RUNRECOVERY when depot
+ * could not be cleaned up and must be reopened to run full recovery.
+ */
+extern int
+kvs_check_depot(const struct kvs_depot *depot);
+
+/*
+ * Depot statistics, gathered from libdb buffer pool, locking, logging and
+ * transaction subsystems.
+ *
+ * Buffer pool:
+ * cache_size:      buffer pool size in bytes ;
+ * cache_page_nr:   number of pages currently held into the buffer pool ;
+ * cache_dirty_nr:  number of dirty pages currently held ;
+ * cache_hit:       number of pages found into the buffer pool ;
+ * cache_miss:      number of pages not found into the buffer pool ;
+ * cache_ratio:     cache_hit / (cache_hit + cache_miss), 0 when no page has
+ *                  been requested ;
+ * page_in:         number of pages read into the buffer pool ;
+ * page_out:        number of pages written from the buffer pool ;
+ * page_evict:      number of clean and dirty pages evicted to make room ;
+ * page_trickle:    number of dirty pages written by trickling.
+ *
+ * Locking:
+ * lock_nr:         number of locks currently held ;
+ * lock_max:        maximum number of locks held at any one time ;
+ * lock_req:        number of lock requests ;
+ * lock_wait:       number of lock requests that had to wait ;
+ * lock_nowait:     number of lock requests that failed because they would
+ *                  have had to wait ;
+ * deadlock_nr:     number of deadlocks ;
+ * lock_timeout_nr: number of lock requests that timed out ;
+ * xact_timeout_nr: number of transactions that timed out ;
+ * detect_nr:       number of lock requests rejected by the background
+ *                  deadlock detector (see struct kvs_depot_conf).
+ *
+ * Logging:
+ * log_bytes:       number of bytes written to the log ;
+ * log_write_nr:    number of log write operations ;
+ * log_sync_nr:     number of log flush operations.
+ *
+ * Transactions:
+ * xact_active:     number of transactions currently active ;
+ * xact_max_active: maximum number of active transactions at any one time ;
+ * xact_snapshot:   number of snapshot transactions currently active ;
+ * xact_begin:      number of transactions begun ;
+ * xact_commit:     number of transactions committed ;
+ * xact_abort:      number of transactions aborted.
+ *
+ * Counters accumulate since depot opening or since the last call given the
+ * KVS_STATS_CLEAR flag, which resets them once retrieved.
+ */
+#define KVS_STATS_CLEAR (DB_STAT_CLEAR)
+
+struct kvs_depot_stats {
+	size_t             cache_size;
+	unsigned long      cache_page_nr;
+	unsigned long      cache_dirty_nr;
+	unsigned long long cache_hit;
+	unsigned long long cache_miss;
+	double             cache_ratio;
+	unsigned long long page_in;
+	unsigned long long page_out;
+	unsigned long long page_evict;
+	unsigned long long page_trickle;
+
+	unsigned long      lock_nr;
+	unsigned long      lock_max;
+	unsigned long long lock_req;
+	unsigned long long lock_wait;
+	unsigned long long lock_nowait;
+	unsigned long long deadlock_nr;
+	unsigned long long lock_timeout_nr;
+	unsigned long long xact_timeout_nr;
+	unsigned long      detect_nr;
+
+	unsigned long long log_bytes;
+	unsigned long long log_write_nr;
+	unsigned long long log_sync_nr;
+
+	unsigned long      xact_active;
+	unsigned long      xact_max_active;
+	unsigned long      xact_snapshot;
+	unsigned long long xact_begin;
+	unsigned long long xact_commit;
+	unsigned long long xact_abort;
+};
+
+extern int
+kvs_get_depot_stats(const struct kvs_depot *depot,
+                    struct kvs_depot_stats *stats,
+                    unsigned int            flags);
+
+/*
+ * Depot startup phase durations, in microseconds.
+ *
+ * env_open:   environment opening, including recovery when needed ;
+ * ckpt:       checkpoint performed right after environment opening ;
+ * store_nr:   number of stores and indices opened since depot opening ;
+ * store_open: cumulative duration of store and index openings, including
+ *             index association (and population, if empty).
+ *
+ * When CONFIG_KVSTORE_DEBUG is enabled, each phase and each store, index or
+ * repository table opening is also reported through debug output.
+ */
+struct kvs_depot_startup {
+	unsigned long long env_open;
+	unsigned long long ckpt;
+	unsigned long      store_nr;
+	unsigned long long store_open;
+};
+
+extern void
+kvs_get_depot_startup(const struct kvs_depot   *depot,
+                      struct kvs_depot_startup *startup);
+
+#if defined(CONFIG_KVSTORE_LATENCY)
+
+/*
+ * Operation latency histograms.
+ *
+ * Latency of core operations is recorded into per-thread histograms which are
+ * merged on demand by kvs_get_lat_hist(), without any locking on recording
+ * side. Histograms are process wide, i.e. they gather operations performed
+ * onto all depots.
+ *
+ * Buckets are log-linear: values are grouped by power of 2, each power of 2
+ * being split into 2^KVS_LAT_SUB_BITS linear sub-buckets, giving a relative
+ * precision of 1 / 2^KVS_LAT_SUB_BITS for the whole nanosecond range.
+ * kvs_lat_bucket_low() returns the smallest value (in nanoseconds) accounted
+ * into a bucket.
+ *
+ * kvs_reset_lat_hist() restarts recording from zero for all operations.
+ */
+enum kvs_lat_op {
+	KVS_LAT_GET,
+	KVS_LAT_PGET,
+	KVS_LAT_PUT,
+	KVS_LAT_DEL,
+	KVS_LAT_ITER,
+	KVS_LAT_COMMIT,
+	KVS_LAT_OP_NR
+};
+
+#define KVS_LAT_SUB_BITS  (3U)
+#define KVS_LAT_BUCKET_NR ((64U - KVS_LAT_SUB_BITS + 1) << KVS_LAT_SUB_BITS)
+
+struct kvs_lat_hist {
+	unsigned long long count;
+	unsigned long long sum;
+	unsigned long long buckets[KVS_LAT_BUCKET_NR];
+};
+
+extern void
+kvs_get_lat_hist(enum kvs_lat_op op, struct kvs_lat_hist *hist);
+
+extern void
+kvs_reset_lat_hist(void);
+
+extern unsigned long long
+kvs_lat_bucket_low(unsigned int bucket);
+
+/*
+ * Return the lower bound of the bucket holding the given percentile (0 to 100)
+ * of recorded latencies, 0 when nothing has been recorded.
+ */
+extern unsigned long long
+kvs_lat_hist_pct(const struct kvs_lat_hist *hist, double pct);
+
+#endif /* defined(CONFIG_KVSTORE_LATENCY) */
+
+#if defined(CONFIG_KVSTORE_MAINT)
+
+/*
+ * Depot background maintenance.
+ *
+ * kvs_start_maint() spawns a thread which wakes up every period milliseconds
+ * to perform housekeeping that would otherwise be deferred to commit or close
+ * time:
+ * - checkpoint once at least ckpt_kbytes kilobytes of log have been written or
+ *   ckpt_minutes minutes have elapsed since the last checkpoint (both 0 means
+ *   checkpoint at each period) ;
+ * - write dirty buffer pool pages back so that at least trickle_pct percent of
+ *   pages are clean (0 disables trickling) ;
+ * - remove log files no longer needed for recovery when archive is true.
+ *
+ * period 0 means KVS_MAINT_PERIOD.
+ * The depot must have been opened with KVS_DEPOT_THREAD. Maintenance is
+ * stopped by kvs_stop_maint() or implicitly by kvs_close_depot().
+ */
+#define KVS_MAINT_PERIOD (1000U)
+
+struct kvs_maint_conf {
+	unsigned int period;
+	unsigned int ckpt_kbytes;
+	unsigned int ckpt_minutes;
+	unsigned int trickle_pct;
+	bool         archive;
+};
+
+/*
+ * Maintenance counters.
+ *
+ * *_nr:          number of successful task runs ;
+ * *_err:         number of failed task runs ;
+ * trickle_pages: number of pages written back by trickling.
+ */
+struct kvs_maint_stats {
+	unsigned long ckpt_nr;
+	unsigned long ckpt_err;
+	unsigned long trickle_nr;
+	unsigned long trickle_err;
+	unsigned long trickle_pages;
+	unsigned long archive_nr;
+	unsigned long archive_err;
+};
+
+extern int
+kvs_start_maint(const struct kvs_depot      *depot,
+                const struct kvs_maint_conf *conf);
+
+extern int
+kvs_stop_maint(const struct kvs_depot *depot);
+
+extern int
+kvs_get_maint_stats(const struct kvs_depot *depot,
+                    struct kvs_maint_stats *stats);
+
+#endif /* defined(CONFIG_KVSTORE_MAINT) */
+
 /******************************************************************************
  * Transaction handling.
  ******************************************************************************/
 
 struct kvs_xact {
-	DB_TXN *txn;
+	DB_TXN                 *txn;
+	const struct kvs_depot *depot;
+	const struct kvs_xact  *parent;
+	unsigned int            flags;
 };
 
-#define KVS_XACT_NOWAIT (DB_TXN_NOWAIT)
+/*
+ * Commit durability flags override the depot default (see struct
+ * kvs_depot_conf) for a single transaction:
+ * KVS_XACT_SYNC:         synchronously flush the log at commit time ;
+ * KVS_XACT_WRITE_NOSYNC: write the log to the filesystem but do not flush it,
+ *                        i.e. survive application crashes only ;
+ * KVS_XACT_NOSYNC:       do not even write the log at commit time, i.e.
+ *                        maintain atomicity and isolation only.
+ * They apply to outermost transactions only.
+ *
+ * Isolation flags relax the default, serializable, isolation level of a
+ * transaction so that readers do not block (and are not blocked by) writers:
+ * KVS_XACT_SNAPSHOT:         read a consistent snapshot of data as of the
+ *                            transaction start without holding read locks ;
+ *                            depot must be opened with KVS_DEPOT_MVCC so that
+ *                            writers keep previous page versions around ;
+ *                            suits long scans and reporting queries that
+ *                            perform no updates ;
+ * KVS_XACT_READ_COMMITTED:   release read locks as soon as the cursor moves
+ *                            away, i.e. the same record read twice may differ ;
+ * KVS_XACT_READ_UNCOMMITTED: read records modified by other transactions
+ *                            before they commit (or abort) ; stores must be
+ *                            opened with KVS_STORE_DIRTY_READ.
+ * A single isolation flag may be given.
+ *
+ * When built with per-thread cursor caching (CONFIG_KVSTORE_CURS_CACHE), a
+ * transaction must be committed / aborted from the thread that finalized its
+ * iterators.
+ */
+#define KVS_XACT_NOWAIT           (DB_TXN_NOWAIT)
+#define KVS_XACT_SYNC             (DB_TXN_SYNC)
+#define KVS_XACT_WRITE_NOSYNC     (DB_TXN_WRITE_NOSYNC)
+#define KVS_XACT_NOSYNC           (DB_TXN_NOSYNC)
+#define KVS_XACT_SNAPSHOT         (DB_TXN_SNAPSHOT)
+#define KVS_XACT_READ_COMMITTED   (DB_READ_COMMITTED)
+#define KVS_XACT_READ_UNCOMMITTED (DB_READ_UNCOMMITTED)
 
 extern int
 kvs_begin_xact(const struct kvs_depot *depot,
@@ -89,6 +461,91 @@ kvs_end_xact(const struct kvs_xact *xact, int status);
 extern int
 kvs_abort_xact(const struct kvs_xact *xact, int status);
 
+/*
+ * Override depot lock / transaction timeouts (see struct kvs_depot_conf) for a
+ * single transaction, allowing latency sensitive callers to fail fast instead
+ * of queueing behind conflicting transactions.
+ *
+ * which:   KVS_XACT_LOCK_TIMEOUT to bound time spent waiting for each lock or
+ *          KVS_XACT_TIMEOUT to bound transaction lifetime ;
+ * timeout: timeout in microseconds, 0 meaning no timeout.
+ */
+#define KVS_XACT_LOCK_TIMEOUT (DB_SET_LOCK_TIMEOUT)
+#define KVS_XACT_TIMEOUT      (DB_SET_TXN_TIMEOUT)
+
+extern int
+kvs_set_xact_timeout(const struct kvs_xact *xact,
+                     unsigned int           which,
+                     unsigned int           timeout);
+
+/*
+ * Transaction runner.
+ *
+ * kvs_run_xact() begins a transaction using flags (see kvs_begin_xact()), runs
+ * fn within it then commits or aborts it according to fn returned status the
+ * same way kvs_end_xact() does. When the transaction fails because of a lock
+ * conflict, i.e. with DB_LOCK_DEADLOCK or DB_LOCK_NOTGRANTED, it is run again
+ * after a randomized exponentially growing delay, at most retry->max_nr times.
+ * fn must thus be safe to run multiple times.
+ * Nested transactions are never retried: conflicts are returned to the caller
+ * so that the outermost transaction may be retried as a whole.
+ *
+ * retry may be NULL to use the following defaults:
+ * max_nr:    maximum number of retries, KVS_XACT_RETRY_NR ;
+ * min_delay: delay before first retry in microseconds, KVS_XACT_DELAY_MIN ;
+ * max_delay: upper bound of retry delays in microseconds, KVS_XACT_DELAY_MAX ;
+ * stats:     optional counters updated on behalf of the caller in addition to
+ *            depot wide ones (see kvs_get_xact_stats()), allowing to locate
+ *            contention hot spots.
+ *
+ * Retry delay is doubled at each retry and randomly picked between half and
+ * the whole of it to keep conflicting transactions from retrying in lockstep.
+ */
+#define KVS_XACT_RETRY_NR  (10U)
+#define KVS_XACT_DELAY_MIN (100U)
+#define KVS_XACT_DELAY_MAX (100000U)
+
+/*
+ * Transaction runner counters.
+ *
+ * run_nr:        number of kvs_run_xact() invocations ;
+ * retry_nr:      number of transactions run again ;
+ * deadlock_nr:   number of DB_LOCK_DEADLOCK failures ;
+ * notgranted_nr: number of DB_LOCK_NOTGRANTED failures ;
+ * giveup_nr:     number of invocations that failed because of a conflict once
+ *                all retries exhausted.
+ *
+ * Counters are updated atomically and may be shared among threads.
+ */
+struct kvs_xact_stats {
+	unsigned long run_nr;
+	unsigned long retry_nr;
+	unsigned long deadlock_nr;
+	unsigned long notgranted_nr;
+	unsigned long giveup_nr;
+};
+
+struct kvs_xact_retry {
+	unsigned int           max_nr;
+	unsigned int           min_delay;
+	unsigned int           max_delay;
+	struct kvs_xact_stats *stats;
+};
+
+typedef int (kvs_xact_fn)(const struct kvs_xact *xact, void *data);
+
+extern int
+kvs_run_xact(const struct kvs_depot      *depot,
+             const struct kvs_xact       *parent,
+             unsigned int                 flags,
+             kvs_xact_fn                 *fn,
+             void                        *data,
+             const struct kvs_xact_retry *retry);
+
+extern void
+kvs_get_xact_stats(const struct kvs_depot *depot,
+                   struct kvs_xact_stats  *stats);
+
 /******************************************************************************
  * Data store / index handling.
  ******************************************************************************/
@@ -99,18 +556,160 @@ struct kvs_chunk {
 	const void * priv;
 };
 
+/*
+ * Key range iterators are bounded by start and end keys. Bounds are inclusive
+ * unless the corresponding KVS_RANGE_*_EXCL flag is set, and a zero sized
+ * bound leaves its side of the range open.
+ * Range and bound data are referenced, not copied: they must remain valid
+ * until the iterator is finalized.
+ */
+#define KVS_RANGE_START_EXCL (1U << 0)
+#define KVS_RANGE_END_EXCL   (1U << 1)
+
+struct kvs_range {
+	struct kvs_chunk start;
+	struct kvs_chunk end;
+	unsigned int     flags;
+};
+
+/*
+ * B-tree key comparators.
+ *
+ * Comparators are given to libdb as is, i.e. they are invoked directly by
+ * B-tree searches without any intermediate dispatching. The default (NULL)
+ * comparator orders keys lexicographically by bytes.
+ *
+ * Built-in comparators:
+ * kvs_cmp_be_uint: keys are big-endian unsigned integers of any width ;
+ * kvs_cmp_be_int:  keys are big-endian two's complement signed integers of
+ *                  any width ;
+ * kvs_cmp_lpfx:    keys are composite, made of a sequence of fields, each of
+ *                  which is prefixed with its length encoded as a 16 bits
+ *                  big-endian integer (see kvs_pack_lpfx()) ; fields are
+ *                  compared lexicographically one after the other.
+ *
+ * All of them fall back to a plain memcmp() when comparing keys of identical
+ * size and layout.
+ */
+typedef int (kvs_cmp_fn)(DB *db, const DBT *a, const DBT *b, size_t *locp);
+
+extern int
+kvs_cmp_be_uint(DB *db, const DBT *a, const DBT *b, size_t *locp);
+
+extern int
+kvs_cmp_be_int(DB *db, const DBT *a, const DBT *b, size_t *locp);
+
+extern int
+kvs_cmp_lpfx(DB *db, const DBT *a, const DBT *b, size_t *locp);
+
+#define KVS_LPFX_FIELD_SIZE(_size) \
+	(sizeof(uint16_t) + (_size))
+
+/*
+ * Append a field of size bytes to the length-prefixed composite key located
+ * at buff and return the number of bytes written.
+ * buff must be at least KVS_LPFX_FIELD_SIZE(size) bytes large.
+ */
+static inline size_t
+kvs_pack_lpfx(void *buff, const void *data, uint16_t size)
+{
+	unsigned char *b = buff;
+
+	b[0] = (unsigned char)(size >> 8);
+	b[1] = (unsigned char)size;
+	memcpy(&b[2], data, size);
+
+	return KVS_LPFX_FIELD_SIZE(size);
+}
+
+struct kvs_iter_bulk;
+
 struct kvs_iter {
-	DBC *curs;
+	DBC                    *curs;
+	struct kvs_iter_bulk   *bulk;
+	const struct kvs_range *range;
+	kvs_cmp_fn             *cmp;
+	bool                    park;
 };
 
+/*
+ * Default size of bulk iterator buffers, i.e., the amount of memory records are
+ * fetched into at each underlying cursor retrieval.
+ */
+#define KVS_ITER_BULK_SIZE (64U << 10)
+
+/*
+ * dups is a second, read-only handle onto duplicate-sorted index records as
+ * they are stored, i.e. field / primary key pairs. libdb forbids bulk
+ * retrieval through associated secondaries, this one is not associated.
+ */
 struct kvs_store {
-	DB *db;
+	DB         *db;
+	kvs_cmp_fn *cmp;
+	DB         *dups;
+};
+
+/*
+ * Per-store tuning.
+ *
+ * page_size:        size of underlying database pages, a power of 2 from 512
+ *                   bytes up to 64 kB ;
+ * bt_minkey:        minimum number of keys stored onto each B-tree page, i.e.
+ *                   the maximum size of items stored inline before being
+ *                   pushed to overflow pages (strrec / attribute stores and
+ *                   indices) ;
+ * heap_region_size: number of pages per heap region (autorec stores) ;
+ * cmp:              key comparator of B-tree stores and indices (see
+ *                   kvs_cmp_fn above) ; must remain the same for the whole
+ *                   store lifetime, i.e. across re-openings ;
+ * flags:            a combination of KVS_STORE_* flags below.
+ *
+ * KVS_STORE_DUPSORT turns an index into a non-unique one: a field value may
+ * then map to multiple primary records, sorted by primary key. Such indices
+ * support by-field iteration which retrieves matching primary keys in bulk.
+ *
+ * KVS_STORE_COMPRESS enables libdb's default B-tree compression codec which
+ * stores each key as a suffix of the previous one on the same page (prefix
+ * compression) ; it suits stores and indices keyed by long strings sharing
+ * common prefixes, such as hierarchical paths, at the expense of CPU cycles
+ * spent (de)compressing pages.
+ *
+ * KVS_STORE_DIRTY_READ allows transactions started with
+ * KVS_XACT_READ_UNCOMMITTED to read store records modified by other
+ * transactions but not yet committed.
+ *
+ * A zero value keeps the corresponding libdb default.
+ * See https://docs.oracle.com/database/bdb181/html/programmer_reference/general_am_conf.html
+ */
+#define KVS_STORE_NOCHKSUM   (1U << 0)
+#define KVS_STORE_NOREVSPLIT (1U << 1)
+#define KVS_STORE_COMPRESS   (1U << 2)
+#define KVS_STORE_DUPSORT    (1U << 3)
+#define KVS_STORE_DIRTY_READ (1U << 4)
+
+struct kvs_store_conf {
+	unsigned int page_size;
+	unsigned int bt_minkey;
+	unsigned int heap_region_size;
+	kvs_cmp_fn  *cmp;
+	unsigned int flags;
 };
 
 typedef int (kvs_bind_indx_fn)(const struct kvs_chunk *pkey,
                                const struct kvs_chunk *item,
                                struct kvs_chunk       *skey);
 
+extern int
+kvs_open_indx_conf(struct kvs_store            *indx,
+                   const struct kvs_store      *store,
+                   const struct kvs_depot      *depot,
+                   const struct kvs_xact       *xact,
+                   const char                  *path,
+                   const char                  *name,
+                   const struct kvs_store_conf *conf,
+                   mode_t                       mode,
+                   kvs_bind_indx_fn            *bind);
+
 extern int
 kvs_open_indx(struct kvs_store       *indx,
               const struct kvs_store *store,
@@ -124,4 +723,94 @@ kvs_open_indx(struct kvs_store       *indx,
 extern int
 kvs_close_indx(const struct kvs_store *store);
 
+/*
+ * Store statistics.
+ *
+ * rec_nr:       number of records ;
+ * page_size:    size of underlying database pages ;
+ * page_nr:      number of pages ;
+ * depth:        number of B-tree levels (0 for heap stores) ;
+ * intl_page_nr: number of B-tree internal pages ;
+ * leaf_page_nr: number of B-tree leaf pages ;
+ * ovfl_page_nr: number of overflow pages, i.e. pages holding items too large
+ *               to be stored inline (see kvs_store_conf.bt_minkey) ;
+ * free_page_nr: number of pages on the free list.
+ *
+ * Given the KVS_STATS_FAST flag, only counters that do not require to walk the
+ * whole store are retrieved, such as page size and count ; other ones are
+ * zeroed.
+ */
+#define KVS_STATS_FAST (DB_FAST_STAT)
+
+struct kvs_store_stats {
+	unsigned long rec_nr;
+	unsigned int  page_size;
+	unsigned long page_nr;
+	unsigned int  depth;
+	unsigned long intl_page_nr;
+	unsigned long leaf_page_nr;
+	unsigned long ovfl_page_nr;
+	unsigned long free_page_nr;
+};
+
+extern int
+kvs_get_store_stats(const struct kvs_store *store,
+                    const struct kvs_xact  *xact,
+                    struct kvs_store_stats *stats,
+                    unsigned int            flags);
+
+#if defined(CONFIG_KVSTORE_INDX_BUILD)
+
+/*
+ * Parallel index build.
+ *
+ * kvs_build_indx() opens an index the same way kvs_open_indx_conf() does.
+ * When the index is empty, instead of letting libdb populate it from a single
+ * thread walking the whole primary store, records are read in bulk, one key
+ * range per bulk buffer, and dispatched to thread_nr worker threads which
+ * compute secondary keys using the bind callback. Resulting index records are
+ * then sorted, bulk loaded into the index and the index is finally associated
+ * with its primary store.
+ *
+ * thread_nr: number of worker threads, 0 means one per online CPU ;
+ * bulk_size: size of primary read / index write bulk buffers, 0 means
+ *            KVS_INDX_BUILD_BULK_SIZE ;
+ * progress:  optional callback invoked after each primary key range has been
+ *            processed (KVS_INDX_BUILD_SCAN phase) and after each bulk index
+ *            write (KVS_INDX_BUILD_LOAD phase), with the number of index
+ *            records computed / loaded so far. Invocations are serialized but
+ *            may happen from worker threads.
+ */
+#define KVS_INDX_BUILD_BULK_SIZE (1U << 20)
+
+enum kvs_indx_build_phase {
+	KVS_INDX_BUILD_SCAN,
+	KVS_INDX_BUILD_LOAD
+};
+
+typedef void (kvs_indx_build_progress_fn)(enum kvs_indx_build_phase  phase,
+                                          unsigned long              count,
+                                          void                      *data);
+
+struct kvs_indx_build {
+	unsigned int                thread_nr;
+	size_t                      bulk_size;
+	kvs_indx_build_progress_fn *progress;
+	void                       *data;
+};
+
+extern int
+kvs_build_indx(struct kvs_store            *indx,
+               const struct kvs_store      *store,
+               const struct kvs_depot      *depot,
+               const struct kvs_xact       *xact,
+               const char                  *path,
+               const char                  *name,
+               const struct kvs_store_conf *conf,
+               mode_t                       mode,
+               kvs_bind_indx_fn            *bind,
+               const struct kvs_indx_build *build);
+
+#endif /* defined(CONFIG_KVSTORE_INDX_BUILD) */
+
 #endif /* _KVS_STORE_H */
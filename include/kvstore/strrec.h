@@ -18,11 +18,92 @@ kvs_strrec_iter_next(const struct kvs_iter *iter,
                      struct kvs_chunk      *id,
                      struct kvs_chunk      *item);
 
+extern int
+kvs_strrec_iter_last(const struct kvs_iter *iter,
+                     struct kvs_chunk      *id,
+                     struct kvs_chunk      *item);
+
+extern int
+kvs_strrec_iter_prev(const struct kvs_iter *iter,
+                     struct kvs_chunk      *id,
+                     struct kvs_chunk      *item);
+
+extern int
+kvs_strrec_iter_seek(const struct kvs_iter  *iter,
+                     const struct kvs_chunk *from,
+                     struct kvs_chunk       *id,
+                     struct kvs_chunk       *item);
+
+extern int
+kvs_strrec_field_iter_first(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            struct kvs_chunk      *id,
+                            struct kvs_chunk      *item);
+
+extern int
+kvs_strrec_field_iter_next(const struct kvs_iter *iter,
+                           struct kvs_chunk      *field,
+                           struct kvs_chunk      *id,
+                           struct kvs_chunk      *item);
+
+extern int
+kvs_strrec_field_iter_last(const struct kvs_iter *iter,
+                           struct kvs_chunk      *field,
+                           struct kvs_chunk      *id,
+                           struct kvs_chunk      *item);
+
+extern int
+kvs_strrec_field_iter_prev(const struct kvs_iter *iter,
+                           struct kvs_chunk      *field,
+                           struct kvs_chunk      *id,
+                           struct kvs_chunk      *item);
+
+extern int
+kvs_strrec_field_iter_seek(const struct kvs_iter *iter,
+                           struct kvs_chunk      *field,
+                           struct kvs_chunk      *id,
+                           struct kvs_chunk      *item);
+
+extern int
+kvs_strrec_iter_byfield_first(const struct kvs_iter *iter,
+                              struct kvs_chunk      *id,
+                              struct kvs_chunk      *item);
+
+extern int
+kvs_strrec_iter_byfield_next(const struct kvs_iter *iter,
+                             struct kvs_chunk      *id,
+                             struct kvs_chunk      *item);
+
 extern int
 kvs_strrec_init_iter(const struct kvs_store *store,
                      const struct kvs_xact  *xact,
                      struct kvs_iter        *iter);
 
+extern int
+kvs_strrec_init_bulk_iter(const struct kvs_store *store,
+                          const struct kvs_xact  *xact,
+                          struct kvs_iter        *iter,
+                          size_t                  size);
+
+extern int
+kvs_strrec_init_range_iter(const struct kvs_store *store,
+                           const struct kvs_xact  *xact,
+                           struct kvs_iter        *iter,
+                           const struct kvs_range *range);
+
+extern int
+kvs_strrec_init_field_iter(const struct kvs_store *index,
+                           const struct kvs_xact  *xact,
+                           struct kvs_iter        *iter,
+                           const struct kvs_range *range);
+
+extern int
+kvs_strrec_init_byfield_iter(const struct kvs_store *index,
+                             const struct kvs_xact  *xact,
+                             struct kvs_iter        *iter,
+                             const struct kvs_chunk *field,
+                             size_t                  size);
+
 extern int
 kvs_strrec_fini_iter(const struct kvs_iter *iter);
 
@@ -32,6 +113,13 @@ kvs_strrec_get_byid(const struct kvs_store *store,
                     const struct kvs_chunk *id,
                     struct kvs_chunk       *item);
 
+extern int
+kvs_strrec_load_byid(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const struct kvs_chunk *id,
+                     void                   *data,
+                     size_t                 *size);
+
 extern int
 kvs_strrec_get_byfield(const struct kvs_store *index,
                        const struct kvs_xact  *xact,
@@ -51,16 +139,38 @@ kvs_strrec_put(const struct kvs_store *store,
                const struct kvs_chunk *id,
                const struct kvs_chunk *item);
 
+extern int
+kvs_strrec_put_batch(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const struct kvs_chunk *ids,
+                     const struct kvs_chunk *items,
+                     unsigned int            nr);
+
 extern int
 kvs_strrec_del_byid(const struct kvs_store *store,
                     const struct kvs_xact  *xact,
                     const struct kvs_chunk *id);
 
+extern int
+kvs_strrec_del_batch(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const struct kvs_chunk *ids,
+                     unsigned int            nr);
+
 extern int
 kvs_strrec_del_byfield(const struct kvs_store *index,
                        const struct kvs_xact  *xact,
                        const struct kvs_chunk *field);
 
+extern int
+kvs_strrec_open_conf(struct kvs_store            *store,
+                     const struct kvs_depot      *depot,
+                     const struct kvs_xact       *xact,
+                     const char                  *path,
+                     const char                  *name,
+                     const struct kvs_store_conf *conf,
+                     mode_t                       mode);
+
 extern int
 kvs_strrec_open(struct kvs_store       *store,
                 const struct kvs_depot *depot,
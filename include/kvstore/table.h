@@ -11,17 +11,30 @@ typedef int (kvs_table_open_store_fn)(struct kvs_table       *table,
                                       const struct kvs_xact  *xact,
                                       mode_t                  mode);
 
+typedef int (kvs_table_open_store_conf_fn)(struct kvs_table            *table,
+                                           const struct kvs_depot      *depot,
+                                           const struct kvs_xact       *xact,
+                                           const struct kvs_store_conf *conf,
+                                           mode_t                       mode);
+
 typedef int (kvs_table_close_store_fn)(const struct kvs_table *table);
 
+/*
+ * Either open or open_conf must be given. When given, open_conf is preferred
+ * and passed conf as is, which it should give down to the underlying store
+ * opening routine.
+ */
 struct kvs_table_store_ops {
-	kvs_table_open_store_fn  *open;
-	kvs_table_close_store_fn *close;
+	kvs_table_open_store_fn      *open;
+	kvs_table_close_store_fn     *close;
+	kvs_table_open_store_conf_fn *open_conf;
+	const struct kvs_store_conf  *conf;
 };
 
 #define kvs_table_assert_store_ops(_ops) \
 	({ \
 		kvs_assert(_ops); \
-		kvs_assert((_ops)->open); \
+		kvs_assert((_ops)->open || (_ops)->open_conf); \
 		kvs_assert((_ops)->close); \
 	 })
 
@@ -0,0 +1,751 @@
+#include "common.h"
+#include <kvstore/store.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/*
+ * Index records computed by worker threads are packed into arenas to spare
+ * one memory allocation per primary record.
+ */
+#define KVS_INDX_ARENA_SIZE (1U << 20)
+
+struct kvs_indx_arena {
+	struct kvs_indx_arena *next;
+	size_t                 used;
+	size_t                 size;
+	unsigned char          data[];
+};
+
+/* Secondary key immediately followed by primary key. */
+struct kvs_indx_entry {
+	u_int32_t     ssize;
+	u_int32_t     psize;
+	unsigned char data[];
+};
+
+/* A bulk buffer holding a range of primary records. */
+struct kvs_indx_batch {
+	struct kvs_indx_batch *next;
+	DBT                    buff;
+};
+
+struct kvs_indx_builder;
+
+struct kvs_indx_worker {
+	pthread_t                 thread;
+	struct kvs_indx_builder  *builder;
+	struct kvs_indx_arena    *arena;
+	struct kvs_indx_entry   **entries;
+	size_t                    nr;
+	size_t                    max;
+	size_t                    curr;
+	size_t                    max_size;
+};
+
+struct kvs_indx_builder {
+	pthread_mutex_t              lock;
+	pthread_cond_t               cond;
+	struct kvs_indx_batch       *head;
+	struct kvs_indx_batch      **tail;
+	unsigned int                 pend_nr;
+	unsigned int                 pend_max;
+	bool                         done;
+	int                          err;
+	unsigned long                count;
+	const struct kvs_store      *indx;
+	kvs_bind_indx_fn            *bind;
+	const struct kvs_indx_build *build;
+};
+
+static void
+kvs_indx_free_batch(struct kvs_indx_batch *batch)
+{
+	free(batch->buff.data);
+	free(batch);
+}
+
+static void
+kvs_indx_progress(const struct kvs_indx_build *build,
+                  enum kvs_indx_build_phase    phase,
+                  unsigned long                count)
+{
+	if (build && build->progress)
+		build->progress(phase, count, build->data);
+}
+
+/* Record first error and wake everyone up so that the build stops ASAP. */
+static void
+kvs_indx_abort(struct kvs_indx_builder *builder, int err)
+{
+	kvs_assert(err);
+
+	pthread_mutex_lock(&builder->lock);
+
+	if (!builder->err)
+		builder->err = err;
+	pthread_cond_broadcast(&builder->cond);
+
+	pthread_mutex_unlock(&builder->lock);
+}
+
+static int
+kvs_indx_push_batch(struct kvs_indx_builder *builder,
+                    struct kvs_indx_batch   *batch)
+{
+	int err;
+
+	pthread_mutex_lock(&builder->lock);
+
+	/* Bound the number of pending batches to limit memory usage. */
+	while (!builder->err && (builder->pend_nr >= builder->pend_max))
+		pthread_cond_wait(&builder->cond, &builder->lock);
+
+	err = builder->err;
+	if (!err) {
+		batch->next = NULL;
+		*builder->tail = batch;
+		builder->tail = &batch->next;
+		builder->pend_nr++;
+		pthread_cond_broadcast(&builder->cond);
+	}
+
+	pthread_mutex_unlock(&builder->lock);
+
+	if (err)
+		kvs_indx_free_batch(batch);
+
+	return err;
+}
+
+static struct kvs_indx_batch *
+kvs_indx_pop_batch(struct kvs_indx_builder *builder)
+{
+	struct kvs_indx_batch *batch = NULL;
+
+	pthread_mutex_lock(&builder->lock);
+
+	while (!builder->err && !builder->head && !builder->done)
+		pthread_cond_wait(&builder->cond, &builder->lock);
+
+	if (!builder->err && builder->head) {
+		batch = builder->head;
+		builder->head = batch->next;
+		if (!builder->head)
+			builder->tail = &builder->head;
+		builder->pend_nr--;
+		pthread_cond_broadcast(&builder->cond);
+	}
+
+	pthread_mutex_unlock(&builder->lock);
+
+	return batch;
+}
+
+static void
+kvs_indx_close_queue(struct kvs_indx_builder *builder)
+{
+	pthread_mutex_lock(&builder->lock);
+
+	builder->done = true;
+	pthread_cond_broadcast(&builder->cond);
+
+	pthread_mutex_unlock(&builder->lock);
+}
+
+static int
+kvs_indx_add_entry(struct kvs_indx_worker *worker,
+                   const struct kvs_chunk *skey,
+                   const void             *pkey,
+                   u_int32_t               psize)
+{
+	struct kvs_indx_arena *arena = worker->arena;
+	struct kvs_indx_entry *ent;
+	size_t                 sz;
+
+	sz = ualign_upper(sizeof(*ent) + skey->size + psize,
+	                  sizeof(u_int32_t));
+
+	if (!arena || ((arena->size - arena->used) < sz)) {
+		size_t asz = (sz > KVS_INDX_ARENA_SIZE) ? sz :
+		                                          KVS_INDX_ARENA_SIZE;
+
+		arena = malloc(sizeof(*arena) + asz);
+		if (!arena)
+			return -ENOMEM;
+
+		arena->next = worker->arena;
+		arena->used = 0;
+		arena->size = asz;
+		worker->arena = arena;
+	}
+
+	if (worker->nr == worker->max) {
+		size_t                  max = worker->max ? (2 * worker->max) :
+		                                            1024;
+		struct kvs_indx_entry **ents;
+
+		ents = realloc(worker->entries, max * sizeof(ents[0]));
+		if (!ents)
+			return -ENOMEM;
+
+		worker->entries = ents;
+		worker->max = max;
+	}
+
+	ent = (struct kvs_indx_entry *)&arena->data[arena->used];
+	ent->ssize = skey->size;
+	ent->psize = psize;
+	memcpy(&ent->data[0], skey->data, skey->size);
+	memcpy(&ent->data[skey->size], pkey, psize);
+
+	arena->used += sz;
+	worker->entries[worker->nr++] = ent;
+
+	if ((skey->size + psize) > worker->max_size)
+		worker->max_size = skey->size + psize;
+
+	return 0;
+}
+
+static int
+kvs_indx_bind_batch(struct kvs_indx_worker *worker,
+                    struct kvs_indx_batch  *batch)
+{
+	kvs_bind_indx_fn *bind = worker->builder->bind;
+	void             *ptr;
+	unsigned long     nr = 0;
+
+	DB_MULTIPLE_INIT(ptr, &batch->buff);
+
+	while (true) {
+		void             *kdata;
+		u_int32_t         ksize;
+		void             *idata;
+		u_int32_t         isize;
+		struct kvs_chunk  pk;
+		struct kvs_chunk  itm = { 0, };
+		struct kvs_chunk  sk;
+		int               err;
+
+		DB_MULTIPLE_KEY_NEXT(ptr, &batch->buff, kdata, ksize, idata, isize);
+		if (!ptr)
+			break;
+
+		pk.size = ksize;
+		pk.data = kdata;
+		pk.priv = NULL;
+		itm.size = isize;
+		itm.data = idata;
+
+		err = bind(&pk, &itm, &sk);
+		if (err < 0)
+			return err;
+
+		/* Zero sized secondary key: record is not to be indexed. */
+		if (!sk.size)
+			continue;
+
+		kvs_assert(sk.data);
+
+		/* Secondary key may be volatile: copy it right now. */
+		err = kvs_indx_add_entry(worker, &sk, kdata, ksize);
+		if (err)
+			return err;
+
+		nr++;
+	}
+
+	pthread_mutex_lock(&worker->builder->lock);
+
+	worker->builder->count += nr;
+	kvs_indx_progress(worker->builder->build,
+	                  KVS_INDX_BUILD_SCAN,
+	                  worker->builder->count);
+
+	pthread_mutex_unlock(&worker->builder->lock);
+
+	return 0;
+}
+
+/* Compare secondary keys using the index comparator. */
+static int
+kvs_indx_cmp_skey(const struct kvs_store      *indx,
+                  const struct kvs_indx_entry *a,
+                  const struct kvs_indx_entry *b)
+{
+	size_t len;
+	int    ret;
+
+	if (indx->cmp) {
+		const DBT ak = { .data = (void *)a->data, .size = a->ssize };
+		const DBT bk = { .data = (void *)b->data, .size = b->ssize };
+
+		return indx->cmp(indx->db, &ak, &bk, NULL);
+	}
+
+	len = (a->ssize < b->ssize) ? a->ssize : b->ssize;
+	ret = memcmp(a->data, b->data, len);
+	if (ret)
+		return ret;
+
+	return (int)(a->ssize > b->ssize) - (int)(a->ssize < b->ssize);
+}
+
+/*
+ * Order index records the way the index B-tree does: by secondary key, then
+ * by primary key, i.e. the default duplicate ordering.
+ */
+static int
+kvs_indx_cmp_entry(const void *first, const void *second, void *data)
+{
+	const struct kvs_indx_entry *a = *(struct kvs_indx_entry * const *)first;
+	const struct kvs_indx_entry *b = *(struct kvs_indx_entry * const *)second;
+	size_t                       len;
+	int                          ret;
+
+	ret = kvs_indx_cmp_skey(data, a, b);
+	if (ret)
+		return ret;
+
+	len = (a->psize < b->psize) ? a->psize : b->psize;
+	ret = memcmp(&a->data[a->ssize], &b->data[b->ssize], len);
+	if (ret)
+		return ret;
+
+	return (int)(a->psize > b->psize) - (int)(a->psize < b->psize);
+}
+
+static void *
+kvs_indx_work(void *data)
+{
+	struct kvs_indx_worker  *worker = data;
+	struct kvs_indx_builder *builder = worker->builder;
+	struct kvs_indx_batch   *batch;
+	int                      err;
+
+	while ((batch = kvs_indx_pop_batch(builder))) {
+		err = kvs_indx_bind_batch(worker, batch);
+		kvs_indx_free_batch(batch);
+
+		if (err) {
+			kvs_indx_abort(builder, err);
+			return NULL;
+		}
+	}
+
+	pthread_mutex_lock(&builder->lock);
+	err = builder->err;
+	pthread_mutex_unlock(&builder->lock);
+
+	/* Sort this worker's share so that the loader may merge them. */
+	if (!err && worker->nr)
+		qsort_r(worker->entries,
+		        worker->nr,
+		        sizeof(worker->entries[0]),
+		        kvs_indx_cmp_entry,
+		        (void *)builder->indx);
+
+	return NULL;
+}
+
+static void
+kvs_indx_fini_worker(struct kvs_indx_worker *worker)
+{
+	struct kvs_indx_arena *arena = worker->arena;
+
+	while (arena) {
+		struct kvs_indx_arena *next = arena->next;
+
+		free(arena);
+		arena = next;
+	}
+
+	free(worker->entries);
+}
+
+/* Read primary store a bulk buffer, i.e. a key range, at a time. */
+static int
+kvs_indx_scan(struct kvs_indx_builder *builder,
+              const struct kvs_store  *store,
+              const struct kvs_xact   *xact,
+              size_t                   size)
+{
+	DBC          *curs;
+	unsigned int  flags = DB_FIRST;
+	int           err;
+
+	err = store->db->cursor(store->db, xact->txn, &curs, 0);
+	kvs_assert(err != EINVAL);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	while (true) {
+		struct kvs_indx_batch *batch;
+		DBT                    key = { 0, };
+
+		batch = malloc(sizeof(*batch));
+		if (!batch) {
+			err = -ENOMEM;
+			break;
+		}
+
+		memset(&batch->buff, 0, sizeof(batch->buff));
+		batch->buff.data = malloc(size);
+		if (!batch->buff.data) {
+			free(batch);
+			err = -ENOMEM;
+			break;
+		}
+		batch->buff.ulen = size;
+		batch->buff.flags = DB_DBT_USERMEM;
+
+		err = curs->c_get(curs,
+		                  &key,
+		                  &batch->buff,
+		                  flags | DB_MULTIPLE_KEY);
+		if (err == DB_BUFFER_SMALL) {
+			/* Record larger than buffer: grow this one only. */
+			size_t  sz = ualign_upper(batch->buff.size, 1024);
+			void   *data;
+
+			data = realloc(batch->buff.data, sz);
+			if (!data) {
+				kvs_indx_free_batch(batch);
+				err = -ENOMEM;
+				break;
+			}
+
+			batch->buff.data = data;
+			batch->buff.ulen = sz;
+
+			err = curs->c_get(curs,
+			                  &key,
+			                  &batch->buff,
+			                  flags | DB_MULTIPLE_KEY);
+		}
+		kvs_assert(err != EINVAL);
+
+		if (err) {
+			kvs_indx_free_batch(batch);
+			if (err == DB_NOTFOUND)
+				err = 0;
+			else
+				err = kvs_err_from_bdb(err);
+			break;
+		}
+
+		err = kvs_indx_push_batch(builder, batch);
+		if (err)
+			break;
+
+		flags = DB_NEXT;
+	}
+
+	curs->c_close(curs);
+
+	return err;
+}
+
+static struct kvs_indx_worker *
+kvs_indx_next_entry(struct kvs_indx_worker *workers, unsigned int nr)
+{
+	struct kvs_indx_worker *min = NULL;
+	unsigned int            w;
+
+	for (w = 0; w < nr; w++) {
+		struct kvs_indx_worker *wrk = &workers[w];
+
+		if (wrk->curr == wrk->nr)
+			continue;
+
+		if (!min ||
+		    (kvs_indx_cmp_entry(&wrk->entries[wrk->curr],
+		                        &min->entries[min->curr],
+		                        (void *)wrk->builder->indx) < 0))
+			min = wrk;
+	}
+
+	return min;
+}
+
+/*
+ * Merge sorted worker shares and write them into the index using bulk puts.
+ * Since records are inserted in key order, B-tree pages are filled one after
+ * the other.
+ */
+static int
+kvs_indx_load(struct kvs_indx_builder *builder,
+              struct kvs_indx_worker  *workers,
+              unsigned int             nr,
+              const struct kvs_xact   *xact,
+              size_t                   size)
+{
+	const struct kvs_store      *indx = builder->indx;
+	const struct kvs_indx_entry *prev = NULL;
+	struct kvs_indx_worker      *wrk;
+	u_int32_t                    flags;
+	bool                         uniq;
+	size_t                       max_size = 0;
+	unsigned long                cnt = 0;
+	unsigned long                loaded = 0;
+	DBT                          bulk;
+	void                        *ptr;
+	unsigned int                 w;
+	int                          err;
+
+	err = indx->db->get_flags(indx->db, &flags);
+	kvs_assert(!err);
+	uniq = !(flags & DB_DUPSORT);
+
+	for (w = 0; w < nr; w++)
+		if (workers[w].max_size > max_size)
+			max_size = workers[w].max_size;
+
+	if (KVS_BULK_KEY_SIZE(1, max_size) > size)
+		size = KVS_BULK_KEY_SIZE(1, max_size);
+
+	err = kvs_init_bulk(&bulk, size, &ptr);
+	if (err)
+		return err;
+
+	while ((wrk = kvs_indx_next_entry(workers, nr))) {
+		const struct kvs_indx_entry *ent = wrk->entries[wrk->curr++];
+
+		/*
+		 * Mimic libdb unique secondary index integrity checking (see
+		 * kvs_put()).
+		 */
+		if (uniq && prev && !kvs_indx_cmp_skey(indx, prev, ent)) {
+			err = DB_KEYEXIST;
+			goto fini;
+		}
+		prev = ent;
+
+		DB_MULTIPLE_KEY_WRITE_NEXT(ptr,
+		                           &bulk,
+		                           &ent->data[0],
+		                           ent->ssize,
+		                           &ent->data[ent->ssize],
+		                           ent->psize);
+		if (ptr) {
+			cnt++;
+			continue;
+		}
+
+		/* Buffer full: flush it and start over. */
+		err = kvs_put_bulk(indx, xact, &bulk);
+		if (err)
+			goto fini;
+
+		loaded += cnt;
+		kvs_indx_progress(builder->build, KVS_INDX_BUILD_LOAD, loaded);
+
+		DB_MULTIPLE_WRITE_INIT(ptr, &bulk);
+		DB_MULTIPLE_KEY_WRITE_NEXT(ptr,
+		                           &bulk,
+		                           &ent->data[0],
+		                           ent->ssize,
+		                           &ent->data[ent->ssize],
+		                           ent->psize);
+		kvs_assert(ptr);
+		cnt = 1;
+	}
+
+	if (cnt) {
+		err = kvs_put_bulk(indx, xact, &bulk);
+		if (err)
+			goto fini;
+
+		loaded += cnt;
+		kvs_indx_progress(builder->build, KVS_INDX_BUILD_LOAD, loaded);
+	}
+
+fini:
+	kvs_fini_bulk(&bulk);
+
+	return err;
+}
+
+static int
+kvs_indx_populate(const struct kvs_store      *indx,
+                  const struct kvs_store      *store,
+                  const struct kvs_xact       *xact,
+                  kvs_bind_indx_fn            *bind,
+                  const struct kvs_indx_build *build)
+{
+	struct kvs_indx_builder  builder;
+	struct kvs_indx_worker  *workers;
+	unsigned int             nr = 0;
+	unsigned int             w;
+	size_t                   size = 0;
+	u_int32_t                pgsz;
+	int                      err;
+
+	if (build) {
+		nr = build->thread_nr;
+		size = build->bulk_size;
+	}
+
+	if (!nr) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nr = (cpus > 0) ? (unsigned int)cpus : 1;
+	}
+
+	/*
+	 * BDB requires bulk read buffers to be at least as large as the store
+	 * page size and a multiple of 1024 bytes.
+	 */
+	err = store->db->get_pagesize(store->db, &pgsz);
+	kvs_assert(!err);
+	if (!size)
+		size = KVS_INDX_BUILD_BULK_SIZE;
+	if (size < pgsz)
+		size = pgsz;
+	size = ualign_upper(size, 1024);
+
+	workers = calloc(nr, sizeof(workers[0]));
+	if (!workers)
+		return -ENOMEM;
+
+	pthread_mutex_init(&builder.lock, NULL);
+	pthread_cond_init(&builder.cond, NULL);
+	builder.head = NULL;
+	builder.tail = &builder.head;
+	builder.pend_nr = 0;
+	builder.pend_max = 2 * nr;
+	builder.done = false;
+	builder.err = 0;
+	builder.count = 0;
+	builder.indx = indx;
+	builder.bind = bind;
+	builder.build = build;
+
+	for (w = 0; w < nr; w++) {
+		workers[w].builder = &builder;
+
+		err = -pthread_create(&workers[w].thread,
+		                      NULL,
+		                      kvs_indx_work,
+		                      &workers[w]);
+		if (err) {
+			kvs_indx_abort(&builder, err);
+			break;
+		}
+	}
+
+	/* Only the opening thread may use the transaction: read from here. */
+	if (w == nr) {
+		err = kvs_indx_scan(&builder, store, xact, size);
+		if (err)
+			kvs_indx_abort(&builder, err);
+	}
+
+	kvs_indx_close_queue(&builder);
+
+	nr = w;
+	for (w = 0; w < nr; w++)
+		pthread_join(workers[w].thread, NULL);
+
+	/* Discard batches left over by an aborted build. */
+	while (builder.head) {
+		struct kvs_indx_batch *batch = builder.head;
+
+		builder.head = batch->next;
+		kvs_indx_free_batch(batch);
+	}
+
+	err = builder.err;
+	if (!err)
+		err = kvs_indx_load(&builder, workers, nr, xact, size);
+
+	for (w = 0; w < nr; w++)
+		kvs_indx_fini_worker(&workers[w]);
+
+	pthread_cond_destroy(&builder.cond);
+	pthread_mutex_destroy(&builder.lock);
+	free(workers);
+
+	return err;
+}
+
+static int
+kvs_indx_isempty(const struct kvs_store *indx, const struct kvs_xact *xact)
+{
+	DBC *curs;
+	DBT  key = { 0, };
+	DBT  item = { 0, };
+	int  err;
+
+	err = indx->db->cursor(indx->db, xact->txn, &curs, 0);
+	kvs_assert(err != EINVAL);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	err = curs->c_get(curs, &key, &item, DB_FIRST);
+	kvs_assert(err != EINVAL);
+
+	curs->c_close(curs);
+
+	if (err == DB_NOTFOUND)
+		return 1;
+
+	return err ? kvs_err_from_bdb(err) : 0;
+}
+
+int
+kvs_build_indx(struct kvs_store            *indx,
+               const struct kvs_store      *store,
+               const struct kvs_depot      *depot,
+               const struct kvs_xact       *xact,
+               const char                  *path,
+               const char                  *name,
+               const struct kvs_store_conf *conf,
+               mode_t                       mode,
+               kvs_bind_indx_fn            *bind,
+               const struct kvs_indx_build *build)
+{
+	kvs_assert(indx);
+	kvs_assert(store);
+	kvs_assert(store->db);
+	kvs_assert_xact(xact);
+	kvs_assert(bind);
+
+	int err;
+
+	err = kvs_open_store(indx,
+	                     depot,
+	                     xact,
+	                     path,
+	                     name,
+	                     DB_BTREE,
+	                     conf,
+	                     mode);
+	if (err)
+		return err;
+
+	/* A populated index is assumed to be in sync with its primary store. */
+	err = kvs_indx_isempty(indx, xact);
+	if (err < 0)
+		return err;
+
+	if (err) {
+		err = kvs_indx_populate(indx, store, xact, bind, build);
+		if (err)
+			return err;
+	}
+
+	/* Index is populated: associate without letting libdb walk it again. */
+	return kvs_associate_indx(indx,
+	                          store,
+	                          depot,
+	                          xact,
+	                          path,
+	                          name,
+	                          conf,
+	                          bind,
+	                          0);
+}
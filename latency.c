@@ -0,0 +1,253 @@
+#include "common.h"
+#include <kvstore/store.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/*
+ * Per-thread histograms.
+ *
+ * Each thread records into a histogram set of its own which only it writes,
+ * using relaxed atomic loads / stores so that readers may merge them without
+ * locking. Histogram sets are linked into a global list they are never removed
+ * from: once its owner thread exits, a set is flagged as unused and later
+ * adopted by a new thread, keeping its counts so that merged histograms remain
+ * consistent.
+ */
+struct kvs_lat_thread {
+	struct kvs_lat_thread *next;
+	bool                   busy;
+	unsigned long long     count[KVS_LAT_OP_NR];
+	unsigned long long     sum[KVS_LAT_OP_NR];
+	unsigned long long     buckets[KVS_LAT_OP_NR][KVS_LAT_BUCKET_NR];
+};
+
+static struct kvs_lat_thread           *kvs_lat_threads;
+static __thread struct kvs_lat_thread  *kvs_lat_self;
+static pthread_key_t                    kvs_lat_key;
+static pthread_once_t                   kvs_lat_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Reset is implemented as a baseline subtracted from merged histograms since
+ * histograms cannot be cleared behind the back of recording threads.
+ */
+static pthread_mutex_t                  kvs_lat_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct kvs_lat_hist              kvs_lat_base[KVS_LAT_OP_NR];
+
+static void
+kvs_lat_release(void *data)
+{
+	struct kvs_lat_thread *thr = data;
+
+	__atomic_store_n(&thr->busy, false, __ATOMIC_RELEASE);
+}
+
+static void
+kvs_lat_init_key(void)
+{
+	pthread_key_create(&kvs_lat_key, kvs_lat_release);
+}
+
+static struct kvs_lat_thread *
+kvs_lat_adopt(void)
+{
+	struct kvs_lat_thread *thr;
+
+	pthread_once(&kvs_lat_once, kvs_lat_init_key);
+
+	/* Reuse a set left over by an exited thread if any. */
+	for (thr = __atomic_load_n(&kvs_lat_threads, __ATOMIC_ACQUIRE);
+	     thr;
+	     thr = thr->next) {
+		bool busy = false;
+
+		if (__atomic_compare_exchange_n(&thr->busy,
+		                                &busy,
+		                                true,
+		                                false,
+		                                __ATOMIC_ACQUIRE,
+		                                __ATOMIC_RELAXED))
+			goto set;
+	}
+
+	thr = calloc(1, sizeof(*thr));
+	if (!thr)
+		return NULL;
+
+	thr->busy = true;
+	thr->next = __atomic_load_n(&kvs_lat_threads, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&kvs_lat_threads,
+	                                    &thr->next,
+	                                    thr,
+	                                    true,
+	                                    __ATOMIC_RELEASE,
+	                                    __ATOMIC_RELAXED))
+		;
+
+set:
+	pthread_setspecific(kvs_lat_key, thr);
+
+	return thr;
+}
+
+static unsigned int
+kvs_lat_bucket(unsigned long long nsec)
+{
+	unsigned int exp;
+
+	if (nsec < (1ULL << KVS_LAT_SUB_BITS))
+		return (unsigned int)nsec;
+
+	exp = 63U - (unsigned int)__builtin_clzll(nsec);
+
+	return ((exp - KVS_LAT_SUB_BITS + 1) << KVS_LAT_SUB_BITS) +
+	       (unsigned int)((nsec >> (exp - KVS_LAT_SUB_BITS)) &
+	                      ((1U << KVS_LAT_SUB_BITS) - 1));
+}
+
+unsigned long long
+kvs_lat_bucket_low(unsigned int bucket)
+{
+	kvs_assert(bucket < KVS_LAT_BUCKET_NR);
+
+	unsigned int exp;
+	unsigned int sub;
+
+	if (bucket < (1U << KVS_LAT_SUB_BITS))
+		return bucket;
+
+	exp = (bucket >> KVS_LAT_SUB_BITS) + KVS_LAT_SUB_BITS - 1;
+	sub = bucket & ((1U << KVS_LAT_SUB_BITS) - 1);
+
+	return (1ULL << exp) +
+	       ((unsigned long long)sub << (exp - KVS_LAT_SUB_BITS));
+}
+
+unsigned long long
+kvs_lat_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return ((unsigned long long)now.tv_sec * 1000000000ULL) +
+	       (unsigned long long)now.tv_nsec;
+}
+
+/* Single writer: no need for atomic read-modify-write operations. */
+#define kvs_lat_inc(_cnt, _val) \
+	__atomic_store_n(_cnt, \
+	                 __atomic_load_n(_cnt, __ATOMIC_RELAXED) + (_val), \
+	                 __ATOMIC_RELAXED)
+
+void
+kvs_lat_record(enum kvs_lat_op op, unsigned long long start)
+{
+	kvs_assert(op < KVS_LAT_OP_NR);
+
+	struct kvs_lat_thread *thr = kvs_lat_self;
+	unsigned long long     nsec = kvs_lat_now() - start;
+
+	if (!thr) {
+		thr = kvs_lat_adopt();
+		if (!thr)
+			/* Out of memory: silently drop sample. */
+			return;
+		kvs_lat_self = thr;
+	}
+
+	kvs_lat_inc(&thr->count[op], 1);
+	kvs_lat_inc(&thr->sum[op], nsec);
+	kvs_lat_inc(&thr->buckets[op][kvs_lat_bucket(nsec)], 1);
+}
+
+static void
+kvs_lat_merge(enum kvs_lat_op op, struct kvs_lat_hist *hist)
+{
+	const struct kvs_lat_thread *thr;
+
+	memset(hist, 0, sizeof(*hist));
+
+	for (thr = __atomic_load_n(&kvs_lat_threads, __ATOMIC_ACQUIRE);
+	     thr;
+	     thr = thr->next) {
+		unsigned int b;
+
+		hist->count += __atomic_load_n(&thr->count[op],
+		                               __ATOMIC_RELAXED);
+		hist->sum += __atomic_load_n(&thr->sum[op], __ATOMIC_RELAXED);
+		for (b = 0; b < KVS_LAT_BUCKET_NR; b++)
+			hist->buckets[b] +=
+				__atomic_load_n(&thr->buckets[op][b],
+				                __ATOMIC_RELAXED);
+	}
+}
+
+void
+kvs_get_lat_hist(enum kvs_lat_op op, struct kvs_lat_hist *hist)
+{
+	kvs_assert(op < KVS_LAT_OP_NR);
+	kvs_assert(hist);
+
+	const struct kvs_lat_hist *base = &kvs_lat_base[op];
+	unsigned int               b;
+
+	pthread_mutex_lock(&kvs_lat_lock);
+
+	kvs_lat_merge(op, hist);
+
+	hist->count -= base->count;
+	hist->sum -= base->sum;
+	for (b = 0; b < KVS_LAT_BUCKET_NR; b++)
+		hist->buckets[b] -= base->buckets[b];
+
+	pthread_mutex_unlock(&kvs_lat_lock);
+}
+
+void
+kvs_reset_lat_hist(void)
+{
+	unsigned int op;
+
+	pthread_mutex_lock(&kvs_lat_lock);
+
+	for (op = 0; op < KVS_LAT_OP_NR; op++)
+		kvs_lat_merge(op, &kvs_lat_base[op]);
+
+	pthread_mutex_unlock(&kvs_lat_lock);
+}
+
+unsigned long long
+kvs_lat_hist_pct(const struct kvs_lat_hist *hist, double pct)
+{
+	kvs_assert(hist);
+	kvs_assert((pct >= 0) && (pct <= 100));
+
+	unsigned long long total = 0;
+	unsigned long long rank;
+	unsigned long long cnt = 0;
+	unsigned int       b;
+
+	/*
+	 * Histograms are merged while being recorded: rely on buckets only
+	 * since count may be slightly off.
+	 */
+	for (b = 0; b < KVS_LAT_BUCKET_NR; b++)
+		total += hist->buckets[b];
+
+	if (!total)
+		return 0;
+
+	rank = (unsigned long long)((pct / 100) * (double)total);
+	if (rank >= total)
+		rank = total - 1;
+
+	for (b = 0; b < KVS_LAT_BUCKET_NR; b++) {
+		cnt += hist->buckets[b];
+		if (cnt > rank)
+			return kvs_lat_bucket_low(b);
+	}
+
+	return kvs_lat_bucket_low(KVS_LAT_BUCKET_NR - 1);
+}
@@ -0,0 +1,254 @@
+#include "common.h"
+#include <kvstore/store.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+struct kvs_maint {
+	pthread_t              thread;
+	DB_ENV                *env;
+	pthread_mutex_t        lock;
+	pthread_cond_t         cond;
+	bool                   stop;
+	struct kvs_maint_conf  conf;
+	struct kvs_maint_stats stats;
+	DB_LSN                 last_ckpt;
+};
+
+/*
+ * Retrieve LSN of the last checkpoint so that checkpoint runs skipped by libdb
+ * because of kbyte / minute thresholds are not accounted for.
+ */
+static int
+kvs_maint_last_ckpt(DB_ENV *env, DB_LSN *lsn)
+{
+	DB_TXN_STAT *stat;
+	int          err;
+
+	err = env->txn_stat(env, &stat, 0);
+	if (err)
+		return err;
+
+	*lsn = stat->st_last_ckp;
+	free(stat);
+
+	return 0;
+}
+
+static void
+kvs_maint_ckpt(struct kvs_maint *maint, DB_ENV *env)
+{
+	DB_LSN lsn;
+	int    err;
+
+	err = env->txn_checkpoint(env,
+	                          maint->conf.ckpt_kbytes,
+	                          maint->conf.ckpt_minutes,
+	                          0);
+	if (!err)
+		err = kvs_maint_last_ckpt(env, &lsn);
+
+	pthread_mutex_lock(&maint->lock);
+
+	if (err)
+		maint->stats.ckpt_err++;
+	else if (log_compare(&lsn, &maint->last_ckpt)) {
+		maint->last_ckpt = lsn;
+		maint->stats.ckpt_nr++;
+	}
+
+	pthread_mutex_unlock(&maint->lock);
+
+	if (err)
+		kvs_env_dbg(env, "maintenance checkpoint failed: %s",
+		            db_strerror(err));
+}
+
+static void
+kvs_maint_trickle(struct kvs_maint *maint, DB_ENV *env)
+{
+	int nr = 0;
+	int err;
+
+	err = env->memp_trickle(env, (int)maint->conf.trickle_pct, &nr);
+
+	pthread_mutex_lock(&maint->lock);
+
+	if (err)
+		maint->stats.trickle_err++;
+	else {
+		maint->stats.trickle_nr++;
+		maint->stats.trickle_pages += (unsigned long)nr;
+	}
+
+	pthread_mutex_unlock(&maint->lock);
+
+	if (err)
+		kvs_env_dbg(env, "maintenance trickle failed: %s",
+		            db_strerror(err));
+}
+
+static void
+kvs_maint_archive(struct kvs_maint *maint, DB_ENV *env)
+{
+	char **paths;
+	int    err;
+
+	/* No list is returned when DB_ARCH_REMOVE is given. */
+	err = env->log_archive(env, &paths, DB_ARCH_REMOVE);
+
+	pthread_mutex_lock(&maint->lock);
+
+	if (err)
+		maint->stats.archive_err++;
+	else
+		maint->stats.archive_nr++;
+
+	pthread_mutex_unlock(&maint->lock);
+
+	if (err)
+		kvs_env_dbg(env, "maintenance archiving failed: %s",
+		            db_strerror(err));
+}
+
+static void *
+kvs_maint_run(void *arg)
+{
+	struct kvs_maint *maint = arg;
+	DB_ENV           *env = maint->env;
+
+	pthread_mutex_lock(&maint->lock);
+
+	while (true) {
+		struct timespec tspec;
+
+		kvs_clock_deadline(&tspec, maint->conf.period);
+		while (!maint->stop) {
+			if (pthread_cond_timedwait(&maint->cond,
+			                           &maint->lock,
+			                           &tspec) == ETIMEDOUT)
+				break;
+		}
+
+		if (maint->stop)
+			break;
+
+		/* Tasks may block on I/O: don't hold the lock meanwhile. */
+		pthread_mutex_unlock(&maint->lock);
+
+		/*
+		 * Trickle before checkpointing so that the checkpoint has
+		 * less dirty pages to flush.
+		 */
+		if (maint->conf.trickle_pct)
+			kvs_maint_trickle(maint, env);
+
+		kvs_maint_ckpt(maint, env);
+
+		if (maint->conf.archive)
+			kvs_maint_archive(maint, env);
+
+		pthread_mutex_lock(&maint->lock);
+	}
+
+	pthread_mutex_unlock(&maint->lock);
+
+	return NULL;
+}
+
+static void
+kvs_free_maint(struct kvs_maint *maint)
+{
+	pthread_cond_destroy(&maint->cond);
+	pthread_mutex_destroy(&maint->lock);
+	free(maint);
+}
+
+int
+kvs_start_maint(const struct kvs_depot *depot, const struct kvs_maint_conf *conf)
+{
+	kvs_assert_depot(depot);
+	kvs_assert(depot->flags & KVS_DEPOT_THREAD);
+	kvs_assert(conf);
+	kvs_assert(conf->trickle_pct <= 100);
+
+	struct kvs_maint *maint;
+	int               err;
+
+	if (depot->priv->maint)
+		return -EALREADY;
+
+	maint = malloc(sizeof(*maint));
+	if (!maint)
+		return -ENOMEM;
+
+	maint->env = depot->env;
+	maint->stop = false;
+	maint->conf = *conf;
+	if (!maint->conf.period)
+		maint->conf.period = KVS_MAINT_PERIOD;
+	memset(&maint->stats, 0, sizeof(maint->stats));
+
+	err = kvs_maint_last_ckpt(depot->env, &maint->last_ckpt);
+	if (err) {
+		free(maint);
+		return kvs_err_from_bdb(err);
+	}
+
+	kvs_init_clock_cond(&maint->cond);
+	pthread_mutex_init(&maint->lock, NULL);
+
+	depot->priv->maint = maint;
+
+	err = pthread_create(&maint->thread, NULL, kvs_maint_run, maint);
+	if (err) {
+		depot->priv->maint = NULL;
+		kvs_free_maint(maint);
+		return -err;
+	}
+
+	return 0;
+}
+
+int
+kvs_stop_maint(const struct kvs_depot *depot)
+{
+	kvs_assert_depot(depot);
+
+	struct kvs_maint *maint = depot->priv->maint;
+
+	if (!maint)
+		return -ENOENT;
+
+	pthread_mutex_lock(&maint->lock);
+	maint->stop = true;
+	pthread_cond_signal(&maint->cond);
+	pthread_mutex_unlock(&maint->lock);
+
+	pthread_join(maint->thread, NULL);
+
+	depot->priv->maint = NULL;
+	kvs_free_maint(maint);
+
+	return 0;
+}
+
+int
+kvs_get_maint_stats(const struct kvs_depot *depot,
+                    struct kvs_maint_stats *stats)
+{
+	kvs_assert_depot(depot);
+	kvs_assert(stats);
+
+	struct kvs_maint *maint = depot->priv->maint;
+
+	if (!maint)
+		return -ENOENT;
+
+	pthread_mutex_lock(&maint->lock);
+	*stats = maint->stats;
+	pthread_mutex_unlock(&maint->lock);
+
+	return 0;
+}
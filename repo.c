@@ -1,3 +1,4 @@
+#include "common.h"
 #include <kvstore/repo.h>
 #include <kvstore/table.h>
 #include <errno.h>
@@ -29,20 +30,27 @@ kvs_repo_do_close(const struct kvs_repo *repo, unsigned int count)
 }
 
 int
-kvs_repo_open(struct kvs_repo *repo,
-              const char      *path,
-              size_t           max_log,
-              unsigned int     flags,
-              mode_t           mode)
+kvs_repo_open_conf(struct kvs_repo             *repo,
+                   const char                  *path,
+                   size_t                       max_log,
+                   const struct kvs_depot_conf *conf,
+                   unsigned int                 flags,
+                   mode_t                       mode)
 {
 	kvs_repo_assert(repo);
 
-	int             err;
-	struct kvs_xact xact;
-	unsigned int    cnt;
-	unsigned int    nr;
-
-	err = kvs_open_depot(&repo->depot, path, max_log, flags, mode);
+	int                err;
+	struct kvs_xact    xact;
+	unsigned int       cnt;
+	unsigned int       nr;
+	unsigned long long start;
+
+	err = kvs_open_depot_conf(&repo->depot,
+	                          path,
+	                          max_log,
+	                          conf,
+	                          flags,
+	                          mode);
 	if (err)
 		return err;
 
@@ -53,17 +61,28 @@ kvs_repo_open(struct kvs_repo *repo,
 
 	nr = repo->desc->tbl_nr;
 	do {
+		start = kvs_now_usec();
 		err = kvs_table_open(&repo->tables[cnt],
 		                     &repo->depot,
 		                     &xact,
 		                     mode);
+		if (!err)
+			kvs_env_dbg(repo->depot.env,
+			            "table #%u opened in %llu us",
+			            cnt,
+			            kvs_now_usec() - start);
 		cnt++;
 	} while (!err && (cnt < nr));
 
+	start = kvs_now_usec();
 	err = kvs_end_xact(&xact, err);
 	if (err)
 		goto close;
 
+	kvs_env_dbg(repo->depot.env,
+	            "tables opening committed in %llu us",
+	            kvs_now_usec() - start);
+
 	return 0;
 
 close:
@@ -74,6 +93,16 @@ close:
 	return err;
 }
 
+int
+kvs_repo_open(struct kvs_repo *repo,
+              const char      *path,
+              size_t           max_log,
+              unsigned int     flags,
+              mode_t           mode)
+{
+	return kvs_repo_open_conf(repo, path, max_log, NULL, flags, mode);
+}
+
 int
 kvs_repo_close(const struct kvs_repo *repo)
 {
@@ -5,6 +5,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ipc.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
 
 #if defined(CONFIG_KVSTORE_DEBUG)
 
@@ -92,6 +95,31 @@ kvs_dup_str(char **string, const void *data, size_t len)
 	return 0;
 }
 
+void
+kvs_init_clock_cond(pthread_cond_t *cond)
+{
+	pthread_condattr_t attr;
+
+	/* Wake up periodically whatever wall clock adjustments. */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+void
+kvs_clock_deadline(struct timespec *tspec, unsigned int msec)
+{
+	clock_gettime(CLOCK_MONOTONIC, tspec);
+
+	tspec->tv_sec += msec / 1000U;
+	tspec->tv_nsec += (long)(msec % 1000U) * 1000000L;
+	if (tspec->tv_nsec >= 1000000000L) {
+		tspec->tv_sec++;
+		tspec->tv_nsec -= 1000000000L;
+	}
+}
+
 #if defined(CONFIG_KVSTORE_TYPE_STRPILE)
 
 #include <utils/pile.h>
@@ -283,6 +311,113 @@ kvs_serialize_strpile(const struct upile *pile, void **data)
 
 #endif /* defined(CONFIG_KVSTORE_TYPE_STRPILE) */
 
+#if defined(CONFIG_KVSTORE_CURS_CACHE)
+
+/*
+ * Per-thread cursor cache.
+ *
+ * Instead of being closed, cursors of finalized iterators are parked into a
+ * thread local cache so that further iterators of the same transaction onto the
+ * same store reuse them, sparing libdb cursor setup and teardown. Since libdb
+ * requires all cursors to be closed before resolving a transaction, parked
+ * cursors are closed right before commit / abort, which must then happen from
+ * the thread that finalized iterators.
+ *
+ * Read committed transactions cursors are not parked since they keep a read
+ * lock onto the record they point to until closed.
+ */
+#define KVS_CURS_CACHE_NR (8U)
+
+struct kvs_curs_cache {
+	unsigned int  nr;
+	DBC          *curs[KVS_CURS_CACHE_NR];
+};
+
+static __thread struct kvs_curs_cache kvs_curs_cache;
+
+static int
+kvs_open_curs(DB *db, const struct kvs_xact *xact, DBC **curs)
+{
+	struct kvs_curs_cache *cache = &kvs_curs_cache;
+	unsigned int           c;
+
+	for (c = 0; c < cache->nr; c++) {
+		DBC *cached = cache->curs[c];
+
+		if ((cached->dbp == db) && (cached->txn == xact->txn)) {
+			cache->curs[c] = cache->curs[--cache->nr];
+			*curs = cached;
+
+			return 0;
+		}
+	}
+
+	return db->cursor(db, xact->txn, curs, 0);
+}
+
+static int
+kvs_close_curs(DBC *curs, bool park)
+{
+	struct kvs_curs_cache *cache = &kvs_curs_cache;
+
+	if (park && (cache->nr < KVS_CURS_CACHE_NR)) {
+		cache->curs[cache->nr++] = curs;
+		return 0;
+	}
+
+	return curs->c_close(curs);
+}
+
+/* Close cursors parked on behalf of the given transaction. */
+static int
+kvs_flush_curs(const DB_TXN *txn)
+{
+	struct kvs_curs_cache *cache = &kvs_curs_cache;
+	unsigned int           c = 0;
+	int                    err = 0;
+
+	while (c < cache->nr) {
+		DBC *curs = cache->curs[c];
+		int  ret;
+
+		if (curs->txn != txn) {
+			c++;
+			continue;
+		}
+
+		ret = curs->c_close(curs);
+		kvs_assert(ret != EINVAL);
+		if (!err)
+			err = ret;
+
+		cache->curs[c] = cache->curs[--cache->nr];
+	}
+
+	return err;
+}
+
+#else  /* !defined(CONFIG_KVSTORE_CURS_CACHE) */
+
+static int
+kvs_open_curs(DB *db, const struct kvs_xact *xact, DBC **curs)
+{
+	return db->cursor(db, xact->txn, curs, 0);
+}
+
+static int
+kvs_close_curs(DBC *curs, bool park __unused)
+{
+	return curs->c_close(curs);
+}
+
+static int
+kvs_flush_curs(const DB_TXN *txn __unused)
+{
+	return 0;
+}
+
+#endif /* defined(CONFIG_KVSTORE_CURS_CACHE) */
+
 int
 kvs_begin_xact(const struct kvs_depot *depot,
                const struct kvs_xact  *parent,
@@ -292,14 +427,118 @@ kvs_begin_xact(const struct kvs_depot *depot,
 	kvs_assert_depot(depot);
 	kvs_assert(!parent || parent->txn);
 	kvs_assert(xact);
-	kvs_assert(!(flags & ~KVS_XACT_NOWAIT));
+	kvs_assert(!(flags & ~(KVS_XACT_NOWAIT |
+	                       KVS_XACT_DURABILITY |
+	                       KVS_XACT_ISOLATION)));
+	kvs_assert_durability(flags & KVS_XACT_DURABILITY);
+	kvs_assert_isolation(flags & KVS_XACT_ISOLATION);
+	kvs_assert(!(flags & KVS_XACT_SNAPSHOT) ||
+	           (depot->flags & KVS_DEPOT_MVCC));
 
 	int ret;
 
+	/* Durability flags are given at commit time (see kvs_commit_xact()). */
 	ret = depot->env->txn_begin(depot->env,
 	                            parent ? parent->txn : NULL,
 	                            &xact->txn,
-	                            flags);
+	                            flags & (KVS_XACT_NOWAIT |
+	                                     KVS_XACT_ISOLATION));
+	kvs_probe(xact_begin, parent ? parent->txn : NULL, xact->txn, flags, ret);
+	if (ret)
+		return kvs_err_from_bdb(ret);
+
+	xact->depot = depot;
+	xact->parent = parent;
+	xact->flags = flags;
+
+	return 0;
+}
+
+/*
+ * Make all commit records written so far durable, sharing a single log flush
+ * among concurrent committers.
+ */
+static int
+kvs_sync_depot(const struct kvs_depot *depot)
+{
+	struct kvs_depot_priv *priv = depot->priv;
+	unsigned long          req;
+	int                    ret = 0;
+
+	pthread_mutex_lock(&priv->sync_lock);
+
+	/*
+	 * Our commit record has been written: any flush started from now on
+	 * covers it.
+	 */
+	req = ++priv->sync_req;
+
+	while (priv->sync_done < req) {
+		unsigned long last;
+
+		if (priv->syncing) {
+			/* Wait for current leader, then check again. */
+			pthread_cond_wait(&priv->sync_cond, &priv->sync_lock);
+			continue;
+		}
+
+		/* Become leader and flush on behalf of all pending requests. */
+		priv->syncing = true;
+		last = priv->sync_req;
+
+		pthread_mutex_unlock(&priv->sync_lock);
+		ret = depot->env->log_flush(depot->env, NULL);
+		pthread_mutex_lock(&priv->sync_lock);
+
+		priv->syncing = false;
+		if (!ret)
+			priv->sync_done = last;
+		pthread_cond_broadcast(&priv->sync_cond);
+
+		if (ret)
+			break;
+	}
+
+	pthread_mutex_unlock(&priv->sync_lock);
+
+	return kvs_err_from_bdb(ret);
+}
+
+static int
+kvs_resolve_xact(const struct kvs_xact *xact)
+{
+	const struct kvs_depot_priv *priv = xact->depot->priv;
+	unsigned int                 flags = xact->flags & KVS_XACT_DURABILITY;
+	int                          ret;
+
+	ret = kvs_flush_curs(xact->txn);
+	if (ret) {
+		xact->txn->abort(xact->txn);
+		return kvs_err_from_bdb(ret);
+	}
+
+	if (!xact->parent && priv->group) {
+		if (!flags)
+			flags = priv->durability;
+
+		if (!flags || (flags == KVS_XACT_SYNC)) {
+			/*
+			 * Synchronous commit: write commit record without
+			 * flushing and join the current group flush.
+			 */
+			ret = xact->txn->commit(xact->txn,
+			                        KVS_XACT_WRITE_NOSYNC);
+			kvs_assert(ret != EINVAL);
+			if (ret)
+				return kvs_err_from_bdb(ret);
+
+			return kvs_sync_depot(xact->depot);
+		}
+	}
+
+	/* Zero flags: apply depot default configured at opening time. */
+	ret = xact->txn->commit(xact->txn, xact->parent ? 0 : flags);
+	kvs_assert(ret != EINVAL);
 
 	return kvs_err_from_bdb(ret);
 }
@@ -309,12 +548,27 @@ kvs_commit_xact(const struct kvs_xact *xact)
 {
 	kvs_assert_xact(xact);
 
-	int ret;
+	unsigned long long    start = kvs_lat_now();
+	struct kvs_attr_pend *pend;
+	int                   ret;
 
-	ret = xact->txn->commit(xact->txn, 0);
-	kvs_assert(ret != EINVAL);
+	kvs_probe(xact_commit_entry, xact->txn);
 
-	return kvs_err_from_bdb(ret);
+	pend = xact->parent ? NULL : kvs_attr_detach_cache(xact->txn);
+
+	ret = kvs_resolve_xact(xact);
+
+	/*
+	 * A failed commit aborts the transaction: invalidating cached
+	 * attributes is harmless anyway.
+	 */
+	kvs_attr_release_cache(pend, true);
+
+	kvs_lat_record(KVS_LAT_COMMIT, start);
+	/* Handle is released at this point: only its address is of use. */
+	kvs_probe(xact_commit_return, xact->txn, ret);
+
+	return ret;
 }
 
 int
@@ -322,10 +576,20 @@ kvs_rollback_xact(const struct kvs_xact *xact)
 {
 	kvs_assert_xact(xact);
 
-	int ret;
+	struct kvs_attr_pend *pend;
+	int                   ret;
+
+	pend = xact->parent ? NULL : kvs_attr_detach_cache(xact->txn);
+
+	/* Aborting releases all locks anyway: ignore cursor closing errors. */
+	kvs_flush_curs(xact->txn);
 
 	ret = xact->txn->abort(xact->txn);
 	kvs_assert(ret != EINVAL);
+	kvs_probe(xact_abort, xact->txn, ret);
+
+	/* Committed attribute values did not change: keep them cached. */
+	kvs_attr_release_cache(pend, false);
 
 	return kvs_err_from_bdb(ret);
 }
@@ -364,136 +628,1004 @@ kvs_abort_xact(const struct kvs_xact *xact, int status)
 	return status;
 }
 
-#define kvs_assert_iter(_iter) \
-	kvs_assert(_iter); \
-	kvs_assert(&(_iter)->curs)
-
-static int
-kvs_iter_goto(const struct kvs_iter *iter,
-              DBT                   *key,
-              DBT                   *item,
-              unsigned int           flags)
+int
+kvs_set_xact_timeout(const struct kvs_xact *xact,
+                     unsigned int           which,
+                     unsigned int           timeout)
 {
-	kvs_assert_iter(iter);
-	kvs_assert(key || item);
-	kvs_assert(flags & (DB_FIRST | DB_NEXT | DB_LAST | DB_PREV));
-	kvs_assert(!(flags & ~(DB_FIRST | DB_NEXT | DB_LAST | DB_PREV)));
+	kvs_assert_xact(xact);
+	kvs_assert((which == KVS_XACT_LOCK_TIMEOUT) ||
+	           (which == KVS_XACT_TIMEOUT));
 
 	int ret;
 
-	ret = iter->curs->c_get(iter->curs, key, item, flags);
+	ret = xact->txn->set_timeout(xact->txn, timeout, which);
 	kvs_assert(ret != EINVAL);
 
 	return kvs_err_from_bdb(ret);
 }
 
-int
-kvs_iter_goto_first(const struct kvs_iter *iter, DBT *key, DBT *item)
+/* Update depot wide and optional caller transaction runner counters. */
+#define kvs_count_xact_stat(_depot_stats, _stats, _member) \
+	do { \
+		__atomic_fetch_add(&(_depot_stats)->_member, \
+		                   1, \
+		                   __ATOMIC_RELAXED); \
+		if (_stats) \
+			__atomic_fetch_add(&(_stats)->_member, \
+			                   1, \
+			                   __ATOMIC_RELAXED); \
+	} while (0)
+
+/* Return a random delay between half and the whole of given delay. */
+static unsigned int
+kvs_jitter_xact_delay(unsigned int delay, unsigned int *seed)
 {
-	return kvs_iter_goto(iter, key, item, DB_FIRST);
-}
+	unsigned int half = delay / 2;
 
-int
-kvs_iter_goto_next(const struct kvs_iter *iter, DBT *key, DBT *item)
-{
-	return kvs_iter_goto(iter, key, item, DB_NEXT);
+	return half + (unsigned int)rand_r(seed) % (delay - half + 1);
 }
 
 int
-kvs_iter_goto_last(const struct kvs_iter *iter, DBT *key, DBT *item)
+kvs_run_xact(const struct kvs_depot      *depot,
+             const struct kvs_xact       *parent,
+             unsigned int                 flags,
+             kvs_xact_fn                 *fn,
+             void                        *data,
+             const struct kvs_xact_retry *retry)
 {
-	return kvs_iter_goto(iter, key, item, DB_LAST);
+	kvs_assert_depot(depot);
+	kvs_assert(fn);
+	kvs_assert(!retry || (retry->min_delay <= retry->max_delay));
+
+	struct kvs_xact_stats *dstats = &depot->priv->xact_stats;
+	struct kvs_xact_stats *stats = retry ? retry->stats : NULL;
+	unsigned int           max_nr = retry ? retry->max_nr :
+	                                        KVS_XACT_RETRY_NR;
+	unsigned int           delay = retry ? retry->min_delay :
+	                                       KVS_XACT_DELAY_MIN;
+	unsigned int           max_delay = retry ? retry->max_delay :
+	                                           KVS_XACT_DELAY_MAX;
+	unsigned int           seed;
+	unsigned int           nr = 0;
+	struct timespec        tspec;
+	int                    ret;
+
+	kvs_count_xact_stat(dstats, stats, run_nr);
+
+	clock_gettime(CLOCK_MONOTONIC, &tspec);
+	seed = (unsigned int)tspec.tv_nsec ^ (unsigned int)(uintptr_t)&seed;
+
+	while (true) {
+		struct kvs_xact xact;
+
+		ret = kvs_begin_xact(depot, parent, &xact, flags);
+		if (!ret)
+			/* Preserves DB_RUNRECOVERY as kvs_end_xact() does. */
+			ret = kvs_end_xact(&xact, fn(&xact, data));
+
+		if (ret == DB_LOCK_DEADLOCK)
+			kvs_count_xact_stat(dstats, stats, deadlock_nr);
+		else if (ret == DB_LOCK_NOTGRANTED)
+			kvs_count_xact_stat(dstats, stats, notgranted_nr);
+		else
+			return ret;
+
+		if (parent)
+			/* Let the outermost transaction handle the conflict. */
+			return ret;
+
+		if (nr++ >= max_nr) {
+			kvs_count_xact_stat(dstats, stats, giveup_nr);
+			return ret;
+		}
+
+		kvs_count_xact_stat(dstats, stats, retry_nr);
+
+		if (delay) {
+			unsigned int usec = kvs_jitter_xact_delay(delay, &seed);
+
+			tspec.tv_sec = usec / 1000000U;
+			tspec.tv_nsec = (long)(usec % 1000000U) * 1000L;
+			nanosleep(&tspec, NULL);
+
+			delay = (delay > (max_delay / 2)) ? max_delay :
+			                                    delay * 2;
+		}
+	}
 }
 
-int
-kvs_iter_goto_prev(const struct kvs_iter *iter, DBT *key, DBT *item)
+void
+kvs_get_xact_stats(const struct kvs_depot *depot,
+                   struct kvs_xact_stats  *stats)
 {
-	return kvs_iter_goto(iter, key, item, DB_PREV);
+	kvs_assert_depot(depot);
+	kvs_assert(stats);
+
+	const struct kvs_xact_stats *dstats = &depot->priv->xact_stats;
+
+	stats->run_nr = __atomic_load_n(&dstats->run_nr, __ATOMIC_RELAXED);
+	stats->retry_nr = __atomic_load_n(&dstats->retry_nr, __ATOMIC_RELAXED);
+	stats->deadlock_nr = __atomic_load_n(&dstats->deadlock_nr,
+	                                     __ATOMIC_RELAXED);
+	stats->notgranted_nr = __atomic_load_n(&dstats->notgranted_nr,
+	                                       __ATOMIC_RELAXED);
+	stats->giveup_nr = __atomic_load_n(&dstats->giveup_nr,
+	                                   __ATOMIC_RELAXED);
 }
 
-int
-kvs_init_iter(const struct kvs_store *store,
-              const struct kvs_xact  *xact,
-              struct kvs_iter        *iter)
+#define kvs_assert_iter(_iter) \
+	kvs_assert(_iter); \
+	kvs_assert(&(_iter)->curs)
+
+/*
+ * Bulk iteration state.
+ *
+ * Records are retrieved a buffer at a time using DB_MULTIPLE_KEY cursor
+ * operations, then handed out one by one from the buffer. This saves a lot of
+ * cursor locking and page pinning overhead when scanning large stores.
+ */
+struct kvs_iter_bulk {
+	DBT         buff;
+	void       *ptr;
+	bool        recno;
+	db_recno_t  id;
+	/* By-field iteration over duplicate-sorted index records. */
+	DBT         skey;
+	DB         *prim;
+	DB_TXN     *txn;
+};
+
+#define kvs_assert_iter_bulk(_bulk) \
+	kvs_assert(_bulk); \
+	kvs_assert((_bulk)->buff.data); \
+	kvs_assert((_bulk)->buff.ulen); \
+	kvs_assert(!((_bulk)->buff.ulen % 1024)); \
+	kvs_assert((_bulk)->buff.flags == DB_DBT_USERMEM)
+
+/*
+ * Fetch the next batch of records: key / data pairs when flags holds
+ * DB_MULTIPLE_KEY, duplicate data items of the current key when it holds
+ * DB_MULTIPLE.
+ */
+static int
+kvs_iter_fetch_bulk(const struct kvs_iter *iter, DBT *key, unsigned int flags)
 {
-	kvs_assert(store);
-	kvs_assert(store->db);
-	kvs_assert_xact(xact);
-	kvs_assert(iter);
+	kvs_assert_iter(iter);
+	kvs_assert_iter_bulk(iter->bulk);
+	kvs_assert(key);
+	kvs_assert((flags == (DB_FIRST | DB_MULTIPLE_KEY)) ||
+	           (flags == (DB_NEXT | DB_MULTIPLE_KEY)) ||
+	           (flags == (DB_SET | DB_MULTIPLE)) ||
+	           (flags == (DB_NEXT_DUP | DB_MULTIPLE)));
 
-	int ret;
+	struct kvs_iter_bulk *bulk = iter->bulk;
+	int                   ret;
+
+	bulk->ptr = NULL;
+
+	ret = iter->curs->c_get(iter->curs, key, &bulk->buff, flags);
+	if (ret == DB_BUFFER_SMALL) {
+		/*
+		 * Current record does not fit into the bulk buffer: grow it
+		 * to the size reported by BDB and retry since the cursor has
+		 * not moved.
+		 */
+		size_t  sz = ualign_upper(bulk->buff.size, 1024);
+		void   *data;
+
+		data = realloc(bulk->buff.data, sz);
+		if (!data)
+			return -ENOMEM;
+
+		bulk->buff.data = data;
+		bulk->buff.ulen = sz;
+
+		ret = iter->curs->c_get(iter->curs, key, &bulk->buff, flags);
+	}
 
-	ret = store->db->cursor(store->db, xact->txn, &iter->curs, 0);
 	kvs_assert(ret != EINVAL);
+	kvs_assert(ret != DB_BUFFER_SMALL);
+	if (ret)
+		return kvs_err_from_bdb(ret);
 
-	return kvs_err_from_bdb(ret);
+	DB_MULTIPLE_INIT(bulk->ptr, &bulk->buff);
+
+	return 0;
 }
 
-int
-kvs_fini_iter(const struct kvs_iter *iter)
+static int
+kvs_iter_pop_bulk(const struct kvs_iter *iter, DBT *key, DBT *item)
+{
+	kvs_assert_iter(iter);
+	kvs_assert_iter_bulk(iter->bulk);
+
+	struct kvs_iter_bulk *bulk = iter->bulk;
+	void                 *kdata;
+	u_int32_t             ksize;
+	void                 *idata;
+	u_int32_t             isize;
+
+	if (!bulk->ptr)
+		return DB_NOTFOUND;
+
+	if (bulk->prim) {
+		/* Duplicate sets hold data items only, i.e. primary keys. */
+		DB_MULTIPLE_NEXT(bulk->ptr, &bulk->buff, idata, isize);
+		kdata = NULL;
+		ksize = 0;
+	}
+	else if (bulk->recno) {
+		/* Record number based stores return recno / data pairs. */
+		DB_MULTIPLE_RECNO_NEXT(bulk->ptr,
+		                       &bulk->buff,
+		                       bulk->id,
+		                       idata,
+		                       isize);
+		kdata = &bulk->id;
+		ksize = sizeof(bulk->id);
+	}
+	else
+		DB_MULTIPLE_KEY_NEXT(bulk->ptr,
+		                     &bulk->buff,
+		                     kdata,
+		                     ksize,
+		                     idata,
+		                     isize);
+
+	if (!bulk->ptr)
+		return DB_NOTFOUND;
+
+	if (key) {
+		key->data = kdata;
+		key->size = ksize;
+	}
+
+	if (item) {
+		item->data = idata;
+		item->size = isize;
+	}
+
+	return 0;
+}
+
+static int
+kvs_iter_goto_bulk(const struct kvs_iter *iter,
+                   DBT                   *key,
+                   DBT                   *item,
+                   unsigned int           flags)
 {
 	kvs_assert_iter(iter);
+	kvs_assert(key || item);
 
+	DBT tmp = { 0, };
 	int ret;
 
-	ret = iter->curs->c_close(iter->curs);
-	kvs_assert(ret != EINVAL);
+	switch (flags) {
+	case DB_FIRST:
+		ret = kvs_iter_fetch_bulk(iter, &tmp, DB_FIRST | DB_MULTIPLE_KEY);
+		if (ret)
+			return ret;
+		break;
 
-	return kvs_err_from_bdb(ret);
+	case DB_NEXT:
+		ret = kvs_iter_pop_bulk(iter, key, item);
+		if (ret != DB_NOTFOUND)
+			return ret;
+
+		/* Current buffer exhausted: fetch the next batch of records. */
+		ret = kvs_iter_fetch_bulk(iter, &tmp, DB_NEXT | DB_MULTIPLE_KEY);
+		if (ret)
+			return ret;
+		break;
+
+	default:
+		/* BDB supports forward bulk retrieval only. */
+		return -ENOTSUP;
+	}
+
+	return kvs_iter_pop_bulk(iter, key, item);
 }
 
-int
-kvs_get(const struct kvs_store *store,
-        const struct kvs_xact  *xact,
-        DBT                    *key,
-        DBT                    *item,
-        unsigned int            flags)
+/*
+ * Compare key against range bound using the store's B-tree comparator, if any.
+ * Otherwise, apply the lexicographic byte ordering BDB uses by default.
+ */
+static int
+kvs_iter_cmp(const struct kvs_iter  *iter,
+             const DBT              *key,
+             const struct kvs_chunk *bound)
 {
-	kvs_assert(store);
-	kvs_assert(store->db);
-	kvs_assert_xact(xact);
 	kvs_assert(key);
-	kvs_assert(key->size);
 	kvs_assert(key->data);
-	kvs_assert(item);
+	kvs_assert(key->size);
+	kvs_assert(bound);
+	kvs_assert(bound->data);
+	kvs_assert(bound->size);
 
-	int ret;
+	size_t len;
+	int    ret;
 
-	ret = store->db->get(store->db, xact->txn, key, item, flags);
-	kvs_assert(ret != EINVAL);
+	if (iter->cmp) {
+		const DBT bnd = {
+			.data = (void *)bound->data,
+			.size = bound->size
+		};
 
-	return kvs_err_from_bdb(ret);
+		return iter->cmp(iter->curs->dbp, key, &bnd, NULL);
+	}
+
+	len = (key->size < bound->size) ? key->size : bound->size;
+	ret = memcmp(key->data, bound->data, len);
+	if (ret)
+		return ret;
+
+	return (int)(key->size > bound->size) - (int)(key->size < bound->size);
 }
 
-int
-kvs_pget(const struct kvs_store *indx,
-         const struct kvs_xact  *xact,
-         DBT                    *ikey,
-         DBT                    *pkey,
-         DBT                    *item,
-         unsigned int            flags)
+static bool
+kvs_iter_past_end(const struct kvs_iter *iter, const DBT *key)
 {
-	kvs_assert(indx);
-	kvs_assert(indx->db);
-	kvs_assert_xact(xact);
-	kvs_assert(ikey);
-	kvs_assert(ikey->data);
-	kvs_assert(ikey->size);
-	kvs_assert(pkey);
-	kvs_assert(item);
+	const struct kvs_range *range = iter->range;
+	int                     cmp;
 
-	int ret;
+	kvs_assert(range);
 
-	ret = indx->db->pget(indx->db, xact->txn, ikey, pkey, item, flags);
-	kvs_assert(ret != EINVAL);
+	if (!range->end.size)
+		return false;
 
-	return kvs_err_from_bdb(ret);
+	cmp = kvs_iter_cmp(iter, key, &range->end);
+
+	return (cmp > 0) || (!cmp && (range->flags & KVS_RANGE_END_EXCL));
 }
 
-int
-kvs_put(const struct kvs_store *store,
-        const struct kvs_xact  *xact,
-        DBT                    *key,
+static bool
+kvs_iter_before_start(const struct kvs_iter *iter, const DBT *key)
+{
+	const struct kvs_range *range = iter->range;
+	int                     cmp;
+
+	kvs_assert(range);
+
+	if (!range->start.size)
+		return false;
+
+	cmp = kvs_iter_cmp(iter, key, &range->start);
+
+	return (cmp < 0) || (!cmp && (range->flags & KVS_RANGE_START_EXCL));
+}
+
+static int
+kvs_iter_get(const struct kvs_iter *iter,
+             DBT                   *key,
+             DBT                   *pkey,
+             DBT                   *item,
+             unsigned int           flags)
+{
+	kvs_assert_iter(iter);
+	kvs_assert(key || item);
+
+	int ret;
+
+	if (iter->bulk) {
+		/* BDB does not support bulk retrieval from secondaries. */
+		kvs_assert(!pkey);
+
+		return kvs_iter_goto_bulk(iter, key, item, flags);
+	}
+
+	if (pkey)
+		ret = iter->curs->c_pget(iter->curs, key, pkey, item, flags);
+	else
+		ret = iter->curs->c_get(iter->curs, key, item, flags);
+	kvs_assert(ret != EINVAL);
+
+	return kvs_err_from_bdb(ret);
+}
+
+static int
+kvs_iter_goto_range_first(const struct kvs_iter  *iter,
+                          const struct kvs_range *range,
+                          DBT                    *key,
+                          DBT                    *pkey,
+                          DBT                    *item)
+{
+	int ret;
+
+	if (!range->start.size)
+		return kvs_iter_get(iter, key, pkey, item, DB_FIRST);
+
+	/* Jump to smallest key greater than or equal to start bound. */
+	key->data = (void *)range->start.data;
+	key->size = range->start.size;
+	ret = kvs_iter_get(iter, key, pkey, item, DB_SET_RANGE);
+	if (!ret &&
+	    (range->flags & KVS_RANGE_START_EXCL) &&
+	    !kvs_iter_cmp(iter, key, &range->start))
+		ret = kvs_iter_get(iter, key, pkey, item, DB_NEXT_NODUP);
+
+	return ret;
+}
+
+static int
+kvs_iter_goto_range_last(const struct kvs_iter  *iter,
+                         const struct kvs_range *range,
+                         DBT                    *key,
+                         DBT                    *pkey,
+                         DBT                    *item)
+{
+	int ret;
+
+	if (!range->end.size)
+		return kvs_iter_get(iter, key, pkey, item, DB_LAST);
+
+	/*
+	 * Jump to smallest key greater than or equal to end bound, then step
+	 * back once. When end bound is inclusive and present, skip its
+	 * duplicates first so that we land onto the last of them.
+	 */
+	key->data = (void *)range->end.data;
+	key->size = range->end.size;
+	ret = kvs_iter_get(iter, key, pkey, item, DB_SET_RANGE);
+	if (!ret &&
+	    !(range->flags & KVS_RANGE_END_EXCL) &&
+	    !kvs_iter_cmp(iter, key, &range->end))
+		ret = kvs_iter_get(iter, key, pkey, item, DB_NEXT_NODUP);
+
+	if (ret == DB_NOTFOUND)
+		/* No key beyond end bound: range ends with the store. */
+		return kvs_iter_get(iter, key, pkey, item, DB_LAST);
+	else if (ret)
+		return ret;
+
+	return kvs_iter_get(iter, key, pkey, item, DB_PREV);
+}
+
+static int
+kvs_iter_move(const struct kvs_iter *iter,
+              DBT                   *key,
+              DBT                   *pkey,
+              DBT                   *item,
+              unsigned int           flags)
+{
+	kvs_assert_iter(iter);
+	kvs_assert(key || item);
+	kvs_assert((flags == DB_FIRST) ||
+	           (flags == DB_NEXT) ||
+	           (flags == DB_LAST) ||
+	           (flags == DB_PREV) ||
+	           (flags == DB_SET_RANGE));
+	kvs_assert((flags != DB_SET_RANGE) || (key && key->data && key->size));
+
+	const struct kvs_range *range = iter->range;
+	DBT                     tmp = { 0, };
+	int                     ret;
+
+	if (!range)
+		return kvs_iter_get(iter, key, pkey, item, flags);
+
+	kvs_assert(!iter->bulk);
+
+	/* Bounds checking requires current record's key. */
+	if (!key)
+		key = &tmp;
+
+	switch (flags) {
+	case DB_FIRST:
+		ret = kvs_iter_goto_range_first(iter, range, key, pkey, item);
+		break;
+
+	case DB_LAST:
+		ret = kvs_iter_goto_range_last(iter, range, key, pkey, item);
+		break;
+
+	case DB_SET_RANGE:
+		ret = kvs_iter_get(iter, key, pkey, item, DB_SET_RANGE);
+		if (!ret && kvs_iter_before_start(iter, key))
+			/* Seeking before range start: clamp to start bound. */
+			ret = kvs_iter_goto_range_first(iter,
+			                                range,
+			                                key,
+			                                pkey,
+			                                item);
+		break;
+
+	default:
+		ret = kvs_iter_get(iter, key, pkey, item, flags);
+	}
+
+	if (ret)
+		return ret;
+
+	/* Stop as soon as one of the bounds has been crossed. */
+	if (kvs_iter_past_end(iter, key) || kvs_iter_before_start(iter, key)) {
+		/*
+		 * Step back onto the bound's last record so that, as at store
+		 * boundaries, further steps keep failing instead of walking
+		 * records beyond the bound. Report step back failures other
+		 * than a missing record, e.g. deadlocks, so that the caller
+		 * may retry.
+		 */
+		if (flags == DB_NEXT)
+			ret = kvs_iter_get(iter, key, pkey, item, DB_PREV);
+		else if (flags == DB_PREV)
+			ret = kvs_iter_get(iter, key, pkey, item, DB_NEXT);
+
+		if (ret && (ret != DB_NOTFOUND))
+			return ret;
+
+		return DB_NOTFOUND;
+	}
+
+	return 0;
+}
+
+static int
+kvs_iter_goto(const struct kvs_iter *iter,
+              DBT                   *key,
+              DBT                   *pkey,
+              DBT                   *item,
+              unsigned int           flags)
+{
+	unsigned long long start = kvs_lat_now();
+	int                ret;
+
+	kvs_probe(iter_entry, iter->curs, flags);
+
+	ret = kvs_iter_move(iter, key, pkey, item, flags);
+
+	kvs_lat_record(KVS_LAT_ITER, start);
+	kvs_probe(iter_return, iter->curs, flags, ret);
+
+	return ret;
+}
+
+int
+kvs_iter_goto_first(const struct kvs_iter *iter, DBT *key, DBT *item)
+{
+	return kvs_iter_goto(iter, key, NULL, item, DB_FIRST);
+}
+
+int
+kvs_iter_goto_next(const struct kvs_iter *iter, DBT *key, DBT *item)
+{
+	return kvs_iter_goto(iter, key, NULL, item, DB_NEXT);
+}
+
+int
+kvs_iter_goto_last(const struct kvs_iter *iter, DBT *key, DBT *item)
+{
+	return kvs_iter_goto(iter, key, NULL, item, DB_LAST);
+}
+
+int
+kvs_iter_goto_prev(const struct kvs_iter *iter, DBT *key, DBT *item)
+{
+	return kvs_iter_goto(iter, key, NULL, item, DB_PREV);
+}
+
+int
+kvs_iter_goto_seek(const struct kvs_iter *iter, DBT *key, DBT *item)
+{
+	return kvs_iter_goto(iter, key, NULL, item, DB_SET_RANGE);
+}
+
+int
+kvs_iter_pgoto_first(const struct kvs_iter *iter,
+                     DBT                   *skey,
+                     DBT                   *pkey,
+                     DBT                   *item)
+{
+	kvs_assert(pkey);
+
+	return kvs_iter_goto(iter, skey, pkey, item, DB_FIRST);
+}
+
+int
+kvs_iter_pgoto_next(const struct kvs_iter *iter,
+                    DBT                   *skey,
+                    DBT                   *pkey,
+                    DBT                   *item)
+{
+	kvs_assert(pkey);
+
+	return kvs_iter_goto(iter, skey, pkey, item, DB_NEXT);
+}
+
+int
+kvs_iter_pgoto_last(const struct kvs_iter *iter,
+                    DBT                   *skey,
+                    DBT                   *pkey,
+                    DBT                   *item)
+{
+	kvs_assert(pkey);
+
+	return kvs_iter_goto(iter, skey, pkey, item, DB_LAST);
+}
+
+int
+kvs_iter_pgoto_prev(const struct kvs_iter *iter,
+                    DBT                   *skey,
+                    DBT                   *pkey,
+                    DBT                   *item)
+{
+	kvs_assert(pkey);
+
+	return kvs_iter_goto(iter, skey, pkey, item, DB_PREV);
+}
+
+int
+kvs_iter_pgoto_seek(const struct kvs_iter *iter,
+                    DBT                   *skey,
+                    DBT                   *pkey,
+                    DBT                   *item)
+{
+	kvs_assert(pkey);
+
+	return kvs_iter_goto(iter, skey, pkey, item, DB_SET_RANGE);
+}
+
+int
+kvs_init_iter(const struct kvs_store *store,
+              const struct kvs_xact  *xact,
+              struct kvs_iter        *iter)
+{
+	kvs_assert(store);
+	kvs_assert(store->db);
+	kvs_assert_xact(xact);
+	kvs_assert(iter);
+
+	int ret;
+
+	iter->bulk = NULL;
+	iter->range = NULL;
+	iter->cmp = store->cmp;
+	iter->park = !(xact->flags & KVS_XACT_READ_COMMITTED);
+
+	ret = kvs_open_curs(store->db, xact, &iter->curs);
+	kvs_assert(ret != EINVAL);
+
+	return kvs_err_from_bdb(ret);
+}
+
+int
+kvs_init_range_iter(const struct kvs_store *store,
+                    const struct kvs_xact  *xact,
+                    struct kvs_iter        *iter,
+                    const struct kvs_range *range)
+{
+	kvs_assert(!range || !range->start.size || range->start.data);
+	kvs_assert(!range || !range->end.size || range->end.data);
+	kvs_assert(!range ||
+	           !(range->flags & ~(KVS_RANGE_START_EXCL |
+	                              KVS_RANGE_END_EXCL)));
+
+	int ret;
+
+	ret = kvs_init_iter(store, xact, iter);
+	if (ret)
+		return ret;
+
+	iter->range = range;
+
+	return 0;
+}
+
+static struct kvs_iter_bulk *
+kvs_alloc_iter_bulk(const struct kvs_store *store, size_t size)
+{
+	struct kvs_iter_bulk *bulk;
+	DBTYPE                type;
+	u_int32_t             pgsz;
+	int                   ret;
+
+	ret = store->db->get_type(store->db, &type);
+	kvs_assert(!ret);
+
+	ret = store->db->get_pagesize(store->db, &pgsz);
+	kvs_assert(!ret);
+
+	/*
+	 * BDB requires bulk buffers to be at least as large as the store page
+	 * size and a multiple of 1024 bytes.
+	 */
+	if (!size)
+		size = KVS_ITER_BULK_SIZE;
+	else if (size < pgsz)
+		size = pgsz;
+	size = ualign_upper(size, 1024);
+
+	bulk = malloc(sizeof(*bulk));
+	if (!bulk)
+		return NULL;
+
+	memset(bulk, 0, sizeof(*bulk));
+	bulk->buff.data = malloc(size);
+	if (!bulk->buff.data) {
+		free(bulk);
+		return NULL;
+	}
+
+	bulk->buff.ulen = size;
+	bulk->buff.flags = DB_DBT_USERMEM;
+	bulk->recno = (type == DB_RECNO) || (type == DB_QUEUE);
+
+	return bulk;
+}
+
+static void
+kvs_free_iter_bulk(struct kvs_iter_bulk *bulk)
+{
+	free(bulk->buff.data);
+	free(bulk);
+}
+
+int
+kvs_init_bulk_iter(const struct kvs_store *store,
+                   const struct kvs_xact  *xact,
+                   struct kvs_iter        *iter,
+                   size_t                  size)
+{
+	kvs_assert(store);
+	kvs_assert(store->db);
+	kvs_assert_xact(xact);
+	kvs_assert(iter);
+
+	struct kvs_iter_bulk *bulk;
+	int                   ret;
+
+	bulk = kvs_alloc_iter_bulk(store, size);
+	if (!bulk)
+		return -ENOMEM;
+
+	ret = kvs_init_iter(store, xact, iter);
+	if (ret) {
+		kvs_free_iter_bulk(bulk);
+		return ret;
+	}
+
+	iter->bulk = bulk;
+
+	return 0;
+}
+
+/*
+ * Initialize an iterator over all primary records matching the skey field of a
+ * duplicate-sorted index.
+ *
+ * Matching primary keys are retrieved in bulk through the index raw handle
+ * (see struct kvs_store) using DB_MULTIPLE cursor operations, sparing the
+ * secondary B-tree walk a DBcursor->pget() would perform for each hit. Primary
+ * items are then looked up one by one, and only when requested.
+ * skey data is referenced, not copied: it must remain valid until the iterator
+ * is finalized.
+ */
+int
+kvs_init_dups_iter(const struct kvs_store *index,
+                   const struct kvs_xact  *xact,
+                   struct kvs_iter        *iter,
+                   const DBT              *skey,
+                   size_t                  size)
+{
+	kvs_assert(index);
+	kvs_assert(index->db);
+	kvs_assert(index->dups);
+	kvs_assert(index->dups->app_private);
+	kvs_assert_xact(xact);
+	kvs_assert(iter);
+	kvs_assert(skey);
+	kvs_assert(skey->data);
+	kvs_assert(skey->size);
+
+	struct kvs_iter_bulk *bulk;
+	int                   ret;
+
+	bulk = kvs_alloc_iter_bulk(index, size);
+	if (!bulk)
+		return -ENOMEM;
+
+	bulk->skey.data = skey->data;
+	bulk->skey.size = skey->size;
+	bulk->prim = index->dups->app_private;
+	bulk->txn = xact->txn;
+
+	iter->range = NULL;
+	iter->cmp = index->cmp;
+	iter->park = !(xact->flags & KVS_XACT_READ_COMMITTED);
+
+	ret = kvs_open_curs(index->dups, xact, &iter->curs);
+	kvs_assert(ret != EINVAL);
+	if (ret) {
+		kvs_free_iter_bulk(bulk);
+		return kvs_err_from_bdb(ret);
+	}
+
+	iter->bulk = bulk;
+
+	return 0;
+}
+
+static int
+kvs_iter_move_dups(const struct kvs_iter *iter,
+                   DBT                   *pkey,
+                   DBT                   *item,
+                   unsigned int           flags)
+{
+	kvs_assert_iter(iter);
+	kvs_assert_iter_bulk(iter->bulk);
+	kvs_assert(iter->bulk->prim);
+	kvs_assert(pkey);
+
+	struct kvs_iter_bulk *bulk = iter->bulk;
+	DBT                   skey = bulk->skey;
+	int                   ret;
+
+	if (flags == DB_NEXT_DUP) {
+		ret = kvs_iter_pop_bulk(iter, NULL, pkey);
+		if (ret != DB_NOTFOUND)
+			goto get;
+	}
+
+	/* Fetch first or next batch of primary keys. */
+	ret = kvs_iter_fetch_bulk(iter, &skey, flags | DB_MULTIPLE);
+	if (ret)
+		return ret;
+
+	ret = kvs_iter_pop_bulk(iter, NULL, pkey);
+
+get:
+	if (ret || !item)
+		return ret;
+
+	ret = bulk->prim->get(bulk->prim, bulk->txn, pkey, item, 0);
+	kvs_assert(ret != EINVAL);
+
+	return kvs_err_from_bdb(ret);
+}
+
+static int
+kvs_iter_goto_dups(const struct kvs_iter *iter,
+                   DBT                   *pkey,
+                   DBT                   *item,
+                   unsigned int           flags)
+{
+	unsigned long long start = kvs_lat_now();
+	int                ret;
+
+	kvs_probe(iter_entry, iter->curs, flags);
+
+	ret = kvs_iter_move_dups(iter, pkey, item, flags);
+
+	kvs_lat_record(KVS_LAT_ITER, start);
+	kvs_probe(iter_return, iter->curs, flags, ret);
+
+	return ret;
+}
+
+int
+kvs_iter_dups_first(const struct kvs_iter *iter, DBT *pkey, DBT *item)
+{
+	return kvs_iter_goto_dups(iter, pkey, item, DB_SET);
+}
+
+int
+kvs_iter_dups_next(const struct kvs_iter *iter, DBT *pkey, DBT *item)
+{
+	return kvs_iter_goto_dups(iter, pkey, item, DB_NEXT_DUP);
+}
+
+int
+kvs_fini_iter(const struct kvs_iter *iter)
+{
+	kvs_assert_iter(iter);
+
+	int ret;
+
+	if (iter->bulk)
+		kvs_free_iter_bulk(iter->bulk);
+
+	ret = kvs_close_curs(iter->curs, iter->park);
+	kvs_assert(ret != EINVAL);
+
+	return kvs_err_from_bdb(ret);
+}
+
+int
+kvs_get(const struct kvs_store *store,
+        const struct kvs_xact  *xact,
+        DBT                    *key,
+        DBT                    *item,
+        unsigned int            flags)
+{
+	kvs_assert(store);
+	kvs_assert(store->db);
+	kvs_assert_xact(xact);
+	kvs_assert(key);
+	kvs_assert(key->size);
+	kvs_assert(key->data);
+	kvs_assert(item);
+
+	unsigned long long start = kvs_lat_now();
+	int                ret;
+
+	kvs_probe(get_entry, store->db, xact->txn, key->size);
+	ret = store->db->get(store->db, xact->txn, key, item, flags);
+	kvs_lat_record(KVS_LAT_GET, start);
+	kvs_probe(get_return, store->db, xact->txn, key->size, ret);
+	kvs_assert(ret != EINVAL);
+
+	return kvs_err_from_bdb(ret);
+}
+
+int
+kvs_get_into(const struct kvs_store *store,
+             const struct kvs_xact  *xact,
+             DBT                    *key,
+             void                   *data,
+             size_t                 *size)
+{
+	kvs_assert(size);
+	kvs_assert(data || !*size);
+
+	/*
+	 * Have BDB copy item straight into caller's buffer instead of
+	 * allocating / copying it into its own memory first.
+	 * libdb items cannot exceed 4 GB: clamp buffer size accordingly.
+	 */
+	DBT item = {
+		.data  = data,
+		.ulen  = (u_int32_t)((*size > UINT32_MAX) ? UINT32_MAX : *size),
+		.flags = DB_DBT_USERMEM
+	};
+	int ret;
+
+	ret = kvs_get(store, xact, key, &item, 0);
+	if (ret == DB_BUFFER_SMALL) {
+		*size = item.size;
+		return -ENOSPC;
+	}
+
+	if (ret)
+		return ret;
+
+	*size = item.size;
+
+	return 0;
+}
+
+int
+kvs_pget(const struct kvs_store *indx,
+         const struct kvs_xact  *xact,
+         DBT                    *ikey,
+         DBT                    *pkey,
+         DBT                    *item,
+         unsigned int            flags)
+{
+	kvs_assert(indx);
+	kvs_assert(indx->db);
+	kvs_assert_xact(xact);
+	kvs_assert(ikey);
+	kvs_assert(ikey->data);
+	kvs_assert(ikey->size);
+	kvs_assert(pkey);
+	kvs_assert(item);
+
+	unsigned long long start = kvs_lat_now();
+	int                ret;
+
+	kvs_probe(pget_entry, indx->db, xact->txn, ikey->size);
+	ret = indx->db->pget(indx->db, xact->txn, ikey, pkey, item, flags);
+	kvs_lat_record(KVS_LAT_PGET, start);
+	kvs_probe(pget_return, indx->db, xact->txn, ikey->size, ret);
+	kvs_assert(ret != EINVAL);
+
+	return kvs_err_from_bdb(ret);
+}
+
+int
+kvs_put(const struct kvs_store *store,
+        const struct kvs_xact  *xact,
+        DBT                    *key,
         DBT                    *item,
         unsigned int            flags)
 {
@@ -514,13 +1646,18 @@ kvs_put(const struct kvs_store *store,
 	kvs_assert(item);
 	kvs_assert(item->data || !item->size);
 
-	int ret;
+	unsigned long long start = kvs_lat_now();
+	int                ret;
 
+	kvs_probe(put_entry, store->db, xact->txn, key->size, item->size);
 	ret = store->db->put(store->db, xact->txn, key, item, flags);
+	kvs_lat_record(KVS_LAT_PUT, start);
+	kvs_probe(put_return, store->db, xact->txn, key->size, ret);
 
 	/*
 	 * Note: BDB will return EINVAL in case of violation of unique secondary
-	 * index integrity contraint.
+	 * index integrity contraint. Duplicate-sorted indices (see
+	 * KVS_STORE_DUPSORT) are not subject to it.
 	 */
 	if (ret == EINVAL)
 		return DB_KEYEXIST;
@@ -540,14 +1677,328 @@ kvs_del(const struct kvs_store *store,
 	kvs_assert(key->size);
 	kvs_assert(key->data);
 
-	int ret;
+	unsigned long long start = kvs_lat_now();
+	int                ret;
 
+	kvs_probe(del_entry, store->db, xact->txn, key->size);
 	ret = store->db->del(store->db, xact->txn, key, 0);
+	kvs_lat_record(KVS_LAT_DEL, start);
+	kvs_probe(del_return, store->db, xact->txn, key->size, ret);
+	kvs_assert(ret != EINVAL);
+
+	return kvs_err_from_bdb(ret);
+}
+
+int
+kvs_init_bulk(DBT *bulk, size_t size, void **ptr)
+{
+	kvs_assert(bulk);
+	kvs_assert(size > sizeof(u_int32_t));
+	kvs_assert(ptr);
+
+	/* Offsets table is located at the end of buffer: keep it aligned. */
+	size = ualign_upper(size, sizeof(u_int32_t));
+
+	memset(bulk, 0, sizeof(*bulk));
+	bulk->data = malloc(size);
+	if (!bulk->data)
+		return -ENOMEM;
+
+	bulk->ulen = size;
+	bulk->flags = DB_DBT_USERMEM | DB_DBT_BULK;
+
+	DB_MULTIPLE_WRITE_INIT(*ptr, bulk);
+
+	return 0;
+}
+
+void
+kvs_fini_bulk(const DBT *bulk)
+{
+	kvs_assert(bulk);
+
+	free(bulk->data);
+}
+
+int
+kvs_put_bulk(const struct kvs_store *store,
+             const struct kvs_xact  *xact,
+             DBT                    *bulk)
+{
+	kvs_assert(store);
+	kvs_assert(store->db);
+	kvs_assert_xact(xact);
+	kvs_assert(bulk);
+	kvs_assert(bulk->data);
+	kvs_assert(bulk->flags & DB_DBT_BULK);
+
+	DBT item = { 0, };
+	int ret;
+
+	/*
+	 * Key / item pairs are all packed into the key bulk buffer, item
+	 * argument is ignored.
+	 */
+	ret = store->db->put(store->db,
+	                     xact->txn,
+	                     bulk,
+	                     &item,
+	                     DB_MULTIPLE_KEY);
+
+	/* See kvs_put(). */
+	if (ret == EINVAL)
+		return DB_KEYEXIST;
+
+	return kvs_err_from_bdb(ret);
+}
+
+int
+kvs_del_bulk(const struct kvs_store *store,
+             const struct kvs_xact  *xact,
+             DBT                    *bulk)
+{
+	kvs_assert(store);
+	kvs_assert(store->db);
+	kvs_assert_xact(xact);
+	kvs_assert(bulk);
+	kvs_assert(bulk->data);
+	kvs_assert(bulk->flags & DB_DBT_BULK);
+
+	int ret;
+
+	ret = store->db->del(store->db, xact->txn, bulk, DB_MULTIPLE);
 	kvs_assert(ret != EINVAL);
 
 	return kvs_err_from_bdb(ret);
 }
 
+static int
+kvs_cmp_bytes(const unsigned char *a,
+              size_t               asz,
+              const unsigned char *b,
+              size_t               bsz)
+{
+	size_t len = (asz < bsz) ? asz : bsz;
+	int    ret;
+
+	ret = memcmp(a, b, len);
+	if (ret)
+		return ret;
+
+	return (int)(asz > bsz) - (int)(asz < bsz);
+}
+
+int
+kvs_cmp_be_uint(DB        *db __unused,
+                const DBT *a,
+                const DBT *b,
+                size_t    *locp __unused)
+{
+	kvs_assert(a);
+	kvs_assert(b);
+
+	const unsigned char *ad = a->data;
+	const unsigned char *bd = b->data;
+	size_t               asz = a->size;
+	size_t               bsz = b->size;
+
+	if (asz == bsz)
+		/* Fast path: big-endian unsigned ordering is memcmp ordering. */
+		return memcmp(ad, bd, asz);
+
+	/* Skip leading zero bytes so that the widest significant value wins. */
+	while (asz && !*ad) {
+		ad++;
+		asz--;
+	}
+	while (bsz && !*bd) {
+		bd++;
+		bsz--;
+	}
+
+	if (asz != bsz)
+		return (asz > bsz) ? 1 : -1;
+
+	return memcmp(ad, bd, asz);
+}
+
+int
+kvs_cmp_be_int(DB        *db __unused,
+               const DBT *a,
+               const DBT *b,
+               size_t    *locp __unused)
+{
+	kvs_assert(a);
+	kvs_assert(b);
+
+	const unsigned char *ad = a->data;
+	const unsigned char *bd = b->data;
+	size_t               asz = a->size;
+	size_t               bsz = b->size;
+	unsigned char        apad;
+	unsigned char        bpad;
+	size_t               len;
+	size_t               i;
+
+	if (asz && (asz == bsz)) {
+		/*
+		 * Fast path: compare most significant bytes as signed values,
+		 * remaining ones follow memcmp ordering.
+		 */
+		if (ad[0] != bd[0])
+			return (int)(signed char)ad[0] - (int)(signed char)bd[0];
+
+		return memcmp(&ad[1], &bd[1], asz - 1);
+	}
+
+	/*
+	 * Sign extend the narrowest value on the fly: pad its most significant
+	 * bytes with its sign.
+	 */
+	apad = (asz && (ad[0] & 0x80)) ? 0xff : 0;
+	bpad = (bsz && (bd[0] & 0x80)) ? 0xff : 0;
+	if (apad != bpad)
+		return apad ? -1 : 1;
+
+	len = (asz > bsz) ? asz : bsz;
+	for (i = 0; i < len; i++) {
+		unsigned char ab = (i < (len - asz)) ? apad :
+		                                       ad[i - (len - asz)];
+		unsigned char bb = (i < (len - bsz)) ? bpad :
+		                                       bd[i - (len - bsz)];
+
+		if (ab != bb)
+			return (ab > bb) ? 1 : -1;
+	}
+
+	return 0;
+}
+
+int
+kvs_cmp_lpfx(DB        *db __unused,
+             const DBT *a,
+             const DBT *b,
+             size_t    *locp __unused)
+{
+	kvs_assert(a);
+	kvs_assert(b);
+
+	const unsigned char *ad = a->data;
+	const unsigned char *bd = b->data;
+	size_t               asz = a->size;
+	size_t               bsz = b->size;
+
+	while ((asz >= sizeof(uint16_t)) && (bsz >= sizeof(uint16_t))) {
+		size_t alen = ((size_t)ad[0] << 8) | ad[1];
+		size_t blen = ((size_t)bd[0] << 8) | bd[1];
+		int    ret;
+
+		ad += sizeof(uint16_t);
+		asz -= sizeof(uint16_t);
+		bd += sizeof(uint16_t);
+		bsz -= sizeof(uint16_t);
+
+		/* Clamp malformed fields to remaining key bytes. */
+		if (alen > asz)
+			alen = asz;
+		if (blen > bsz)
+			blen = bsz;
+
+		ret = kvs_cmp_bytes(ad, alen, bd, blen);
+		if (ret)
+			return ret;
+
+		ad += alen;
+		asz -= alen;
+		bd += blen;
+		bsz -= blen;
+	}
+
+	/* Keys made of less fields sort first. */
+	return kvs_cmp_bytes(ad, asz, bd, bsz);
+}
+
+static int
+kvs_conf_store(DB *db, DBTYPE type, const struct kvs_store_conf *conf)
+{
+	kvs_assert(!(conf->flags & ~(KVS_STORE_NOCHKSUM |
+	                             KVS_STORE_NOREVSPLIT |
+	                             KVS_STORE_COMPRESS |
+	                             KVS_STORE_DUPSORT |
+	                             KVS_STORE_DIRTY_READ)));
+	kvs_assert(!conf->bt_minkey ||
+	           (type == DB_BTREE) || (type == DB_RECNO));
+	kvs_assert(!conf->heap_region_size || (type == DB_HEAP));
+	kvs_assert(!(conf->flags & KVS_STORE_NOREVSPLIT) ||
+	           (type == DB_BTREE) || (type == DB_RECNO));
+	kvs_assert(!(conf->flags & KVS_STORE_COMPRESS) || (type == DB_BTREE));
+	kvs_assert(!conf->cmp || (type == DB_BTREE));
+	kvs_assert(!(conf->flags & KVS_STORE_DUPSORT) || (type == DB_BTREE));
+
+	int err;
+
+	if (conf->page_size) {
+		err = db->set_pagesize(db, conf->page_size);
+		if (err)
+			return kvs_err_from_bdb(err);
+	}
+
+	if (conf->bt_minkey) {
+		err = db->set_bt_minkey(db, conf->bt_minkey);
+		if (err)
+			return kvs_err_from_bdb(err);
+	}
+
+	if (conf->cmp) {
+		err = db->set_bt_compare(db, conf->cmp);
+		kvs_assert(!err);
+	}
+
+	if (conf->heap_region_size) {
+		err = db->set_heap_regionsize(db, conf->heap_region_size);
+		if (err)
+			return kvs_err_from_bdb(err);
+	}
+
+	if (conf->flags & KVS_STORE_NOREVSPLIT) {
+		/*
+		 * Keep emptied B-tree pages around instead of collapsing the
+		 * tree: spares split / merge cycles for stores which records are
+		 * repeatedly deleted then re-inserted.
+		 */
+		err = db->set_flags(db, DB_REVSPLITOFF);
+		if (err)
+			return kvs_err_from_bdb(err);
+	}
+
+	if (conf->flags & KVS_STORE_DUPSORT) {
+		err = db->set_flags(db, DB_DUPSORT);
+		kvs_assert(!err);
+	}
+
+	if (conf->flags & KVS_STORE_COMPRESS) {
+		/* Use libdb's default (prefix based) compression codec. */
+		err = db->set_bt_compress(db, NULL, NULL);
+		if (err)
+			return kvs_err_from_bdb(err);
+	}
+
+	return 0;
+}
+
+/* Account for the duration of a store opening step started at start. */
+static unsigned long long
+kvs_account_store_open(const struct kvs_depot *depot, unsigned long long start)
+{
+	unsigned long long usec = kvs_now_usec() - start;
+
+	__atomic_add_fetch(&depot->priv->startup.store_open,
+	                   usec,
+	                   __ATOMIC_RELAXED);
+
+	return usec;
+}
+
 /*
  * Warning !
  * Even if open failed, close method SHALL be called ! The reason why is that
@@ -556,13 +2007,14 @@ kvs_del(const struct kvs_store *store,
  * See the Berkeley DB->close() documentation for more infos.
  */
 int
-kvs_open_store(struct kvs_store       *store,
-               const struct kvs_depot *depot,
-               const struct kvs_xact  *xact,
-               const char             *path,
-               const char             *name,
-               DBTYPE                  type,
-               mode_t                  mode)
+kvs_open_store(struct kvs_store            *store,
+               const struct kvs_depot      *depot,
+               const struct kvs_xact       *xact,
+               const char                  *path,
+               const char                  *name,
+               DBTYPE                       type,
+               const struct kvs_store_conf *conf,
+               mode_t                       mode)
 {
 	kvs_assert(store);
 	kvs_assert_depot(depot);
@@ -572,7 +2024,13 @@ kvs_open_store(struct kvs_store       *store,
 	kvs_assert(!((type == DB_HEAP) && name));
 	kvs_assert(!((type == DB_QUEUE) && name));
 
-	int err;
+	unsigned long long start = kvs_now_usec();
+	unsigned long long usec;
+	int                err;
+
+	/* Let kvs_close_indx() cope with a store that failed to open. */
+	store->cmp = conf ? conf->cmp : NULL;
+	store->dups = NULL;
 
 	err = db_create(&store->db, depot->env, 0);
 	kvs_assert(err != EINVAL);
@@ -581,8 +2039,20 @@ kvs_open_store(struct kvs_store       *store,
 		return kvs_err_from_bdb(err);
 	}
 
-	err = store->db->set_flags(store->db, DB_CHKSUM);
-	kvs_assert(!err);
+	if (!conf || !(conf->flags & KVS_STORE_NOCHKSUM)) {
+		err = store->db->set_flags(store->db, DB_CHKSUM);
+		kvs_assert(!err);
+	}
+
+	if (conf) {
+		/*
+		 * Tuning failure: return error and let the caller close the
+		 * store as stated above.
+		 */
+		err = kvs_conf_store(store->db, type, conf);
+		if (err)
+			return err;
+	}
 
 	err = store->db->open(store->db,
 	                      xact ? xact->txn : NULL,
@@ -590,11 +2060,29 @@ kvs_open_store(struct kvs_store       *store,
 	                      name,
 	                      type,
 	                      (xact ? 0 : DB_AUTO_COMMIT) | DB_CREATE |
+	                      ((conf && (conf->flags & KVS_STORE_DIRTY_READ)) ?
+	                       DB_READ_UNCOMMITTED : 0) |
 	                      depot->flags,
 	                      mode & ~(S_IXUSR | S_IXGRP | S_IXOTH));
 	kvs_assert(err != DB_REP_HANDLE_DEAD);
 	kvs_assert(err != DB_REP_LOCKOUT);
 
+	/* Allows tracers to map store handles to files. */
+	kvs_probe(store_open, store->db, path, name, err);
+
+	if (!err) {
+		__atomic_add_fetch(&depot->priv->startup.store_nr,
+		                   1,
+		                   __ATOMIC_RELAXED);
+		usec = kvs_account_store_open(depot, start);
+		kvs_env_dbg(depot->env,
+		            "store %s%s%s opened in %llu us",
+		            path,
+		            name ? ":" : "",
+		            name ? name : "",
+		            usec);
+	}
+
 	return kvs_err_from_bdb(err);
 }
 
@@ -618,6 +2106,7 @@ kvs_close_store(const struct kvs_store *store)
 		 * that the database is recoverable after system / application
 		 * crashes.
 		 */
+		kvs_probe(store_close, store->db);
 		ret = store->db->close(store->db, DB_NOSYNC);
 		kvs_assert(ret != EINVAL);
 
@@ -627,6 +2116,67 @@ kvs_close_store(const struct kvs_store *store)
 	return 0;
 }
 
+int
+kvs_get_store_stats(const struct kvs_store *store,
+                    const struct kvs_xact  *xact,
+                    struct kvs_store_stats *stats,
+                    unsigned int            flags)
+{
+	kvs_assert(store);
+	kvs_assert(store->db);
+	kvs_assert(!xact || xact->txn);
+	kvs_assert(stats);
+	kvs_assert(!(flags & ~KVS_STATS_FAST));
+
+	DBTYPE  type;
+	void   *stat;
+	int     err;
+
+	err = store->db->get_type(store->db, &type);
+	kvs_assert(!err);
+
+	err = store->db->stat(store->db, xact ? xact->txn : NULL, &stat, flags);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	memset(stats, 0, sizeof(*stats));
+
+	switch (type) {
+	case DB_BTREE:
+	case DB_RECNO:
+		{
+			const DB_BTREE_STAT *bt = stat;
+
+			stats->rec_nr = bt->bt_ndata;
+			stats->page_size = bt->bt_pagesize;
+			stats->page_nr = bt->bt_pagecnt;
+			stats->depth = bt->bt_levels;
+			stats->intl_page_nr = bt->bt_int_pg;
+			stats->leaf_page_nr = bt->bt_leaf_pg;
+			stats->ovfl_page_nr = bt->bt_over_pg;
+			stats->free_page_nr = bt->bt_free;
+		}
+		break;
+
+	case DB_HEAP:
+		{
+			const DB_HEAP_STAT *heap = stat;
+
+			stats->rec_nr = heap->heap_nrecs;
+			stats->page_size = heap->heap_pagesize;
+			stats->page_nr = heap->heap_pagecnt;
+		}
+		break;
+
+	default:
+		kvs_assert(0);
+	}
+
+	free(stat);
+
+	return 0;
+}
+
 static int
 kvs_bind_indx(DB *indx, const DBT *pkey, const DBT *item, DBT *skey)
 {
@@ -654,14 +2204,160 @@ kvs_bind_indx(DB *indx, const DBT *pkey, const DBT *item, DBT *skey)
 	if (ret < 0)
 		return ret;
 
-	if (!sk.size)
-		return DB_DONOTINDEX;
+	if (!sk.size)
+		return DB_DONOTINDEX;
+
+	kvs_assert(sk.data);
+
+	memset(skey, 0, sizeof(*skey));
+	skey->data = (void *)sk.data;
+	skey->size = sk.size;
+
+	return 0;
+}
+
+/*
+ * Open the raw handle of a duplicate-sorted index (see struct kvs_store). It
+ * must be configured the same way as the associated handle to be able to
+ * decode index pages.
+ * The primary store handle is recorded as private data so that by-field
+ * iterators may resolve primary keys into items.
+ */
+static int
+kvs_open_dups(struct kvs_store            *indx,
+              const struct kvs_store      *store,
+              const struct kvs_depot      *depot,
+              const struct kvs_xact       *xact,
+              const char                  *path,
+              const char                  *name,
+              const struct kvs_store_conf *conf)
+{
+	DB  *dups;
+	int  err;
+
+	err = db_create(&dups, depot->env, 0);
+	kvs_assert(err != EINVAL);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	indx->dups = dups;
+
+	if (!(conf->flags & KVS_STORE_NOCHKSUM)) {
+		err = dups->set_flags(dups, DB_CHKSUM);
+		kvs_assert(!err);
+	}
+
+	/* Apply the index configuration to the raw handle. */
+	err = kvs_conf_store(dups, DB_BTREE, conf);
+	if (err)
+		return err;
+
+	dups->app_private = store->db;
+
+	err = dups->open(dups,
+	                 xact->txn,
+	                 path,
+	                 name,
+	                 DB_BTREE,
+	                 DB_RDONLY | depot->flags,
+	                 0);
+	kvs_assert(err != DB_REP_HANDLE_DEAD);
+	kvs_assert(err != DB_REP_LOCKOUT);
+
+	return kvs_err_from_bdb(err);
+}
+
+/*
+ * Associate an opened index with its primary store. With DB_CREATE given as
+ * flags, libdb populates an empty index from existing primary records.
+ */
+int
+kvs_associate_indx(struct kvs_store            *indx,
+                   const struct kvs_store      *store,
+                   const struct kvs_depot      *depot,
+                   const struct kvs_xact       *xact,
+                   const char                  *path,
+                   const char                  *name,
+                   const struct kvs_store_conf *conf,
+                   kvs_bind_indx_fn            *bind,
+                   unsigned int                 flags)
+{
+	kvs_assert(indx);
+	kvs_assert(indx->db);
+	kvs_assert(store);
+	kvs_assert(store->db);
+	kvs_assert_xact(xact);
+	kvs_assert(bind);
+	kvs_assert(!(flags & ~DB_CREATE));
+
+	int err;
+
+	indx->db->app_private = bind;
+
+	err = store->db->associate(store->db,
+	                           xact->txn,
+	                           indx->db,
+	                           kvs_bind_indx,
+	                           flags);
+	kvs_assert(err != EINVAL);
+	kvs_assert(err != DB_REP_HANDLE_DEAD);
+	kvs_assert(err != DB_REP_LOCKOUT);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	if (conf && (conf->flags & KVS_STORE_DUPSORT))
+		return kvs_open_dups(indx, store, depot, xact, path, name, conf);
+
+	return 0;
+}
+
+int
+kvs_open_indx_conf(struct kvs_store            *indx,
+                   const struct kvs_store      *store,
+                   const struct kvs_depot      *depot,
+                   const struct kvs_xact       *xact,
+                   const char                  *path,
+                   const char                  *name,
+                   const struct kvs_store_conf *conf,
+                   mode_t                       mode,
+                   kvs_bind_indx_fn            *bind)
+{
+	unsigned long long start;
+	unsigned long long usec;
+	int                err;
+
+	err = kvs_open_store(indx,
+	                     depot,
+	                     xact,
+	                     path,
+	                     name,
+	                     DB_BTREE,
+	                     conf,
+	                     mode);
+	if (err)
+		return kvs_err_from_bdb(err);
 
-	kvs_assert(sk.data);
+	/* Association populates the index when empty: may take a while. */
+	start = kvs_now_usec();
+	err = kvs_associate_indx(indx,
+	                         store,
+	                         depot,
+	                         xact,
+	                         path,
+	                         name,
+	                         conf,
+	                         bind,
+	                         DB_CREATE);
+	if (err)
+		return err;
 
-	memset(skey, 0, sizeof(*skey));
-	skey->data = (void *)sk.data;
-	skey->size = sk.size;
+	usec = kvs_account_store_open(depot, start);
+	kvs_env_dbg(depot->env,
+	            "index %s%s%s associated in %llu us",
+	            path,
+	            name ? ":" : "",
+	            name ? name : "",
+	            usec);
 
 	return 0;
 }
@@ -675,31 +2371,207 @@ kvs_open_indx(struct kvs_store       *indx,
               const char             *name,
               mode_t                  mode,
               kvs_bind_indx_fn       *bind)
+{
+	return kvs_open_indx_conf(indx,
+	                          store,
+	                          depot,
+	                          xact,
+	                          path,
+	                          name,
+	                          NULL,
+	                          mode,
+	                          bind);
+}
+
+int
+kvs_close_indx(const struct kvs_store *store)
+{
+	kvs_assert(store);
+
+	if (store->dups) {
+		int err;
+
+		err = store->dups->close(store->dups, DB_NOSYNC);
+		kvs_assert(err != EINVAL);
+		if (err) {
+			kvs_close_store(store);
+			return kvs_err_from_bdb(err);
+		}
+	}
+
+	return kvs_close_store(store);
+}
+
+/*
+ * Background deadlock detection: break deadlocks (and expire timed out lock
+ * requests) periodically instead of each time a lock request blocks.
+ */
+static void *
+kvs_detect_run(void *arg)
+{
+	const struct kvs_depot *depot = arg;
+	struct kvs_depot_priv  *priv = depot->priv;
+
+	pthread_mutex_lock(&priv->detect_lock);
+
+	while (true) {
+		struct timespec tspec;
+		int             nr = 0;
+		int             err;
+
+		kvs_clock_deadline(&tspec, priv->detect_period);
+		while (!priv->detect_stop) {
+			if (pthread_cond_timedwait(&priv->detect_cond,
+			                           &priv->detect_lock,
+			                           &tspec) == ETIMEDOUT)
+				break;
+		}
+
+		if (priv->detect_stop)
+			break;
+
+		pthread_mutex_unlock(&priv->detect_lock);
+
+		err = depot->env->lock_detect(depot->env, 0, priv->detect, &nr);
+		if (err)
+			kvs_env_dbg(depot->env,
+			            "deadlock detection failed: %s",
+			            db_strerror(err));
+
+		pthread_mutex_lock(&priv->detect_lock);
+
+		priv->detect_nr += (unsigned long)nr;
+	}
+
+	pthread_mutex_unlock(&priv->detect_lock);
+
+	return NULL;
+}
+
+static int
+kvs_start_detect(const struct kvs_depot *depot)
 {
 	int err;
 
-	err = kvs_open_store(indx, depot, xact, path, name, DB_BTREE, mode);
-	if (err)
-		return kvs_err_from_bdb(err);
+	depot->priv->detect_stop = false;
 
-	indx->db->app_private = bind;
+	err = pthread_create(&depot->priv->detect_thread,
+	                     NULL,
+	                     kvs_detect_run,
+	                     (void *)depot);
+	if (err) {
+		depot->priv->detect_stop = true;
+		return -err;
+	}
 
-	err = store->db->associate(store->db,
-	                           xact->txn,
-	                           indx->db,
-	                           kvs_bind_indx,
-	                           DB_CREATE);
-	kvs_assert(err != EINVAL);
-	kvs_assert(err != DB_REP_HANDLE_DEAD);
-	kvs_assert(err != DB_REP_LOCKOUT);
+	return 0;
+}
 
-	return kvs_err_from_bdb(err);
+static void
+kvs_stop_detect(const struct kvs_depot *depot)
+{
+	struct kvs_depot_priv *priv = depot->priv;
+
+	pthread_mutex_lock(&priv->detect_lock);
+	priv->detect_stop = true;
+	pthread_cond_signal(&priv->detect_cond);
+	pthread_mutex_unlock(&priv->detect_lock);
+
+	pthread_join(priv->detect_thread, NULL);
 }
 
-int
-kvs_close_indx(const struct kvs_store *store)
+static struct kvs_depot_priv *
+kvs_alloc_depot_priv(void)
 {
-	return kvs_close_store(store);
+	struct kvs_depot_priv *priv;
+
+	priv = malloc(sizeof(*priv));
+	if (!priv)
+		return NULL;
+
+	priv->durability = 0;
+	priv->group = false;
+	pthread_mutex_init(&priv->sync_lock, NULL);
+	pthread_cond_init(&priv->sync_cond, NULL);
+	priv->syncing = false;
+	priv->sync_req = 0;
+	priv->sync_done = 0;
+	priv->detect = KVS_DETECT_DEFAULT;
+	priv->detect_period = 0;
+	pthread_mutex_init(&priv->detect_lock, NULL);
+	kvs_init_clock_cond(&priv->detect_cond);
+	priv->detect_stop = true;
+	priv->detect_nr = 0;
+	memset(&priv->xact_stats, 0, sizeof(priv->xact_stats));
+	priv->maint = NULL;
+	memset(&priv->startup, 0, sizeof(priv->startup));
+	priv->fast_open = false;
+
+	return priv;
+}
+
+/*
+ * Clean shutdown marker, created into depot directory once closed cleanly and
+ * removed at opening time before any modification may happen.
+ */
+#define KVS_DEPOT_CLEAN_MARK "kvs.clean"
+
+static void
+kvs_set_clean_mark(int dir)
+{
+	int fd;
+
+	fd = openat(dir,
+	            KVS_DEPOT_CLEAN_MARK,
+	            O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+	            S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		/* Next opening will simply run recovery. */
+		return;
+
+	fsync(fd);
+	close(fd);
+
+	fsync(dir);
+}
+
+/*
+ * Remove clean shutdown marker. Returns 1 if it was found, 0 if not or a
+ * negative errno on failure.
+ */
+static int
+kvs_clear_clean_mark(const char *path)
+{
+	int dir;
+	int ret = 1;
+
+	dir = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir < 0)
+		return -errno;
+
+	if (unlinkat(dir, KVS_DEPOT_CLEAN_MARK, 0)) {
+		ret = (errno == ENOENT) ? 0 : -errno;
+		goto close;
+	}
+
+	/* Make sure marker does not show up again after a power cut. */
+	if (fsync(dir))
+		ret = -errno;
+
+close:
+	close(dir);
+
+	return ret;
+}
+
+static void
+kvs_free_depot_priv(struct kvs_depot_priv *priv)
+{
+	pthread_cond_destroy(&priv->detect_cond);
+	pthread_mutex_destroy(&priv->detect_lock);
+	pthread_cond_destroy(&priv->sync_cond);
+	pthread_mutex_destroy(&priv->sync_lock);
+	free(priv);
 }
 
 int
@@ -708,14 +2580,32 @@ kvs_close_depot(const struct kvs_depot *depot)
 	kvs_assert_depot(depot);
 
 	char ** paths;
+	int     dir = -1;
 	int     err;
 
+#if defined(CONFIG_KVSTORE_MAINT)
+	/* Maintenance thread must not use environment once closed. */
+	if (depot->priv->maint)
+		kvs_stop_maint(depot);
+#endif /* defined(CONFIG_KVSTORE_MAINT) */
+
+	if (!depot->priv->detect_stop)
+		kvs_stop_detect(depot);
+
 	err = depot->env->txn_checkpoint(depot->env, 0, 0, 0);
 	kvs_assert(!err);
 
 	err = depot->env->log_archive(depot->env, &paths, DB_ARCH_REMOVE);
 	kvs_assert(!err);
 
+	if (depot->priv->fast_open) {
+		const char *home;
+
+		/* Home directory string is released with environment. */
+		if (!depot->env->get_home(depot->env, &home))
+			dir = open(home, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	}
+
 	/*
 	 * No need to use DB_FORCESYNCENV (over NFS) since memory regions are
 	 * located in system memory.
@@ -723,8 +2613,18 @@ kvs_close_depot(const struct kvs_depot *depot)
 	 * be closed using the DB_NOSYNC flag to spare flash write / erase
 	 * cycles (see bdb_close_store);
 	 */
-	
-	return kvs_err_from_bdb(depot->env->close(depot->env, 0));
+	err = depot->env->close(depot->env, 0);
+
+	if (dir >= 0) {
+		/* Log has been checkpointed: next opening may skip recovery. */
+		if (!err)
+			kvs_set_clean_mark(dir);
+		close(dir);
+	}
+
+	kvs_free_depot_priv(depot->priv);
+
+	return kvs_err_from_bdb(err);
 }
 
 static struct {
@@ -753,12 +2653,274 @@ kvs_print_msg(const DB_ENV *env __unused, const char *msg)
 
 #endif /* defined(CONFIG_KVSTORE_DEBUG) */
 
+/*
+ * Tell failchk whether a thread of control is still alive.
+ *
+ * Threads of the current process cannot be reliably probed once exited: only
+ * track liveness of processes.
+ */
+static int
+kvs_depot_isalive(DB_ENV        *env __unused,
+                  pid_t          pid,
+                  db_threadid_t  tid __unused,
+                  u_int32_t      flags __unused)
+{
+	if (pid == getpid())
+		return 1;
+
+	return !kill(pid, 0) || (errno == EPERM);
+}
+
+#define KVS_DEPOT_GBYTE_SHIFT (30U)
+#define KVS_DEPOT_GBYTE_MASK  ((1UL << KVS_DEPOT_GBYTE_SHIFT) - 1)
+
+static int
+kvs_conf_depot(const struct kvs_depot *depot, const struct kvs_depot_conf *conf)
+{
+	kvs_assert_durability(conf->durability);
+	kvs_assert(conf->detect <= KVS_DETECT_YOUNGEST);
+
+	int err;
+
+	if (conf->cache_size) {
+		/*
+		 * libdb wants cache size expressed as a number of gigabytes plus
+		 * a number of bytes.
+		 */
+		err = depot->env->set_cachesize(
+			depot->env,
+			(u_int32_t)(conf->cache_size >> KVS_DEPOT_GBYTE_SHIFT),
+			(u_int32_t)(conf->cache_size & KVS_DEPOT_GBYTE_MASK),
+			(int)conf->cache_nr);
+		if (err)
+			return kvs_err_from_bdb(err);
+	}
+
+	if (conf->max_mem) {
+		err = depot->env->set_memory_max(
+			depot->env,
+			(u_int32_t)(conf->max_mem >> KVS_DEPOT_GBYTE_SHIFT),
+			(u_int32_t)(conf->max_mem & KVS_DEPOT_GBYTE_MASK));
+		if (err)
+			return kvs_err_from_bdb(err);
+	}
+
+	if (conf->mmap_size) {
+		err = depot->env->set_mp_mmapsize(depot->env, conf->mmap_size);
+		if (err)
+			return kvs_err_from_bdb(err);
+	}
+
+	/*
+	 * Setup default durability so that it also applies to implicit
+	 * (autocommit) transactions.
+	 */
+	if (conf->durability && (conf->durability != KVS_XACT_SYNC)) {
+		err = depot->env->set_flags(depot->env, conf->durability, 1);
+		kvs_assert(!err);
+	}
+
+	depot->priv->durability = conf->durability;
+	depot->priv->group = conf->group_commit;
+
+	if (conf->lock_timeout) {
+		err = depot->env->set_timeout(depot->env,
+		                              conf->lock_timeout,
+		                              DB_SET_LOCK_TIMEOUT);
+		kvs_assert(!err);
+	}
+
+	if (conf->xact_timeout) {
+		err = depot->env->set_timeout(depot->env,
+		                              conf->xact_timeout,
+		                              DB_SET_TXN_TIMEOUT);
+		kvs_assert(!err);
+	}
+
+	if (conf->detect)
+		depot->priv->detect = conf->detect;
+	depot->priv->detect_period = conf->detect_period;
+
+	if (conf->failchk) {
+		/* Allocate room to track threads of control. */
+		err = depot->env->set_thread_count(depot->env, conf->failchk);
+		if (err)
+			return kvs_err_from_bdb(err);
+
+		err = depot->env->set_isalive(depot->env, kvs_depot_isalive);
+		kvs_assert(!err);
+	}
+
+	return 0;
+}
+
 int
-kvs_open_depot(struct kvs_depot *depot,
-               const char       *path,
-               size_t            max_log_size,
-               unsigned int      flags,
-               mode_t            mode)
+kvs_get_depot_conf(const struct kvs_depot *depot, struct kvs_depot_conf *conf)
+{
+	kvs_assert_depot(depot);
+	kvs_assert(conf);
+
+	u_int32_t gbytes;
+	u_int32_t bytes;
+	int       nr;
+	int       err;
+
+	err = depot->env->get_cachesize(depot->env, &gbytes, &bytes, &nr);
+	if (err)
+		return kvs_err_from_bdb(err);
+	conf->cache_size = ((size_t)gbytes << KVS_DEPOT_GBYTE_SHIFT) + bytes;
+	conf->cache_nr = (unsigned int)nr;
+
+	err = depot->env->get_memory_max(depot->env, &gbytes, &bytes);
+	if (err)
+		return kvs_err_from_bdb(err);
+	conf->max_mem = ((size_t)gbytes << KVS_DEPOT_GBYTE_SHIFT) + bytes;
+
+	err = depot->env->get_mp_mmapsize(depot->env, &conf->mmap_size);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	conf->durability = depot->priv->durability ? : KVS_XACT_SYNC;
+	conf->group_commit = depot->priv->group;
+
+	conf->detect = depot->priv->detect;
+	conf->detect_period = depot->priv->detect_period;
+
+	err = depot->env->get_timeout(depot->env,
+	                              &conf->lock_timeout,
+	                              DB_SET_LOCK_TIMEOUT);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	err = depot->env->get_timeout(depot->env,
+	                              &conf->xact_timeout,
+	                              DB_SET_TXN_TIMEOUT);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	conf->fast_open = depot->priv->fast_open;
+
+	err = depot->env->get_thread_count(depot->env, &conf->failchk);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	return 0;
+}
+
+int
+kvs_get_depot_stats(const struct kvs_depot *depot,
+                    struct kvs_depot_stats *stats,
+                    unsigned int            flags)
+{
+	kvs_assert_depot(depot);
+	kvs_assert(stats);
+	kvs_assert(!(flags & ~KVS_STATS_CLEAR));
+
+	DB_ENV        *env = depot->env;
+	DB_MPOOL_STAT *mstat;
+	DB_LOCK_STAT  *lstat = NULL;
+	DB_LOG_STAT   *gstat;
+	DB_TXN_STAT   *tstat;
+	u_int32_t      lflags;
+	int            err;
+
+	memset(stats, 0, sizeof(*stats));
+
+	err = env->memp_stat(env, &mstat, NULL, flags);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	stats->cache_size = ((size_t)mstat->st_gbytes <<
+	                     KVS_DEPOT_GBYTE_SHIFT) + mstat->st_bytes;
+	stats->cache_page_nr = mstat->st_pages;
+	stats->cache_dirty_nr = mstat->st_page_dirty;
+	stats->cache_hit = mstat->st_cache_hit;
+	stats->cache_miss = mstat->st_cache_miss;
+	stats->cache_ratio = (stats->cache_hit + stats->cache_miss) ?
+	                     (double)stats->cache_hit /
+	                     (double)(stats->cache_hit + stats->cache_miss) :
+	                     0;
+	stats->page_in = mstat->st_page_in;
+	stats->page_out = mstat->st_page_out;
+	stats->page_evict = mstat->st_ro_evict + mstat->st_rw_evict;
+	stats->page_trickle = mstat->st_page_trickle;
+	free(mstat);
+
+	/* Private single threaded depots run without locking subsystem. */
+	err = env->get_open_flags(env, &lflags);
+	kvs_assert(!err);
+	if (lflags & DB_INIT_LOCK) {
+		err = env->lock_stat(env, &lstat, flags);
+		if (err)
+			return kvs_err_from_bdb(err);
+	}
+
+	if (lstat) {
+		stats->lock_nr = lstat->st_nlocks;
+		stats->lock_max = lstat->st_maxnlocks;
+		stats->lock_req = lstat->st_nrequests;
+		stats->lock_wait = lstat->st_lock_wait;
+		stats->lock_nowait = lstat->st_lock_nowait;
+		stats->deadlock_nr = lstat->st_ndeadlocks;
+		stats->lock_timeout_nr = lstat->st_nlocktimeouts;
+		stats->xact_timeout_nr = lstat->st_ntxntimeouts;
+		free(lstat);
+	}
+
+	pthread_mutex_lock(&depot->priv->detect_lock);
+	stats->detect_nr = depot->priv->detect_nr;
+	if (flags & KVS_STATS_CLEAR)
+		depot->priv->detect_nr = 0;
+	pthread_mutex_unlock(&depot->priv->detect_lock);
+
+	err = env->log_stat(env, &gstat, flags);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	stats->log_bytes = ((unsigned long long)gstat->st_w_mbytes << 20) +
+	                   gstat->st_w_bytes;
+	stats->log_write_nr = gstat->st_wcount;
+	stats->log_sync_nr = gstat->st_scount;
+	free(gstat);
+
+	err = env->txn_stat(env, &tstat, flags);
+	if (err)
+		return kvs_err_from_bdb(err);
+
+	stats->xact_active = tstat->st_nactive;
+	stats->xact_max_active = tstat->st_maxnactive;
+	stats->xact_snapshot = tstat->st_nsnapshot;
+	stats->xact_begin = tstat->st_nbegins;
+	stats->xact_commit = tstat->st_ncommits;
+	stats->xact_abort = tstat->st_naborts;
+	free(tstat);
+
+	return 0;
+}
+
+void
+kvs_get_depot_startup(const struct kvs_depot   *depot,
+                      struct kvs_depot_startup *startup)
+{
+	kvs_assert_depot(depot);
+	kvs_assert(startup);
+
+	const struct kvs_depot_startup *st = &depot->priv->startup;
+
+	startup->env_open = st->env_open;
+	startup->ckpt = st->ckpt;
+	startup->store_nr = __atomic_load_n(&st->store_nr, __ATOMIC_RELAXED);
+	startup->store_open = __atomic_load_n(&st->store_open,
+	                                      __ATOMIC_RELAXED);
+}
+
+int
+kvs_open_depot_conf(struct kvs_depot            *depot,
+                    const char                  *path,
+                    size_t                       max_log_size,
+                    const struct kvs_depot_conf *conf,
+                    unsigned int                 flags,
+                    mode_t                       mode)
 {
 	kvs_assert(depot);
 	kvs_assert(path);
@@ -767,18 +2929,41 @@ kvs_open_depot(struct kvs_depot *depot,
 	                       KVS_DEPOT_THREAD |
 	                       KVS_DEPOT_MVCC)));
 	kvs_assert(mode);
+	kvs_assert(!conf ||
+	           !conf->detect_period ||
+	           (flags & KVS_DEPOT_THREAD));
+	kvs_assert(!conf || !conf->failchk || !(flags & KVS_DEPOT_PRIV));
 
-	int err;
+	unsigned int       oflags = flags;
+	unsigned int       recover = DB_RECOVER;
+	unsigned long long start;
+	int                err;
 
 	if (mkdir(path, mode)) {
 		if (errno != EEXIST)
 			return -errno;
 	}
 
+	/*
+	 * Always remove clean shutdown marker, whatever fast opening is
+	 * requested or not, so that it cannot outlive an unclean session.
+	 */
+	err = kvs_clear_clean_mark(path);
+	if (err < 0)
+		return err;
+	if (err && conf && conf->fast_open)
+		recover = 0;
+
 	err = db_env_create(&depot->env, 0);
 	if (err)
 		return kvs_err_from_bdb(err);
 
+	depot->priv = kvs_alloc_depot_priv();
+	if (!depot->priv) {
+		depot->env->close(depot->env, 0);
+		return -ENOMEM;
+	}
+
 	/* Setup verbosity. */
 	if (!kvs_verb.out)
 		kvs_verb.out = stderr;
@@ -812,8 +2997,22 @@ kvs_open_depot(struct kvs_depot *depot,
 	err = depot->env->log_set_config(depot->env, DB_LOG_AUTO_REMOVE, 1);
 	kvs_assert(!err);
 
+	/*
+	 * Report lock and transaction timeouts using DB_LOCK_NOTGRANTED so that
+	 * callers may tell them apart from deadlocks.
+	 */
+	err = depot->env->set_flags(depot->env, DB_TIME_NOTGRANTED, 1);
+	kvs_assert(!err);
+
 	kvs_init_log(depot);
 
+	/* Setup buffer pool, region memory sizing and commit durability. */
+	if (conf) {
+		err = kvs_conf_depot(depot, conf);
+		if (err)
+			goto discard;
+	}
+
 	depot->flags = flags & (KVS_DEPOT_THREAD | KVS_DEPOT_MVCC);
 
 	/*
@@ -854,25 +3053,61 @@ kvs_open_depot(struct kvs_depot *depot,
 		flags |= DB_INIT_LOCK;
 
 	/*
-	 * Setup deadlock detector using the default strategy (random locker
-	 * selection).
+	 * Setup deadlock detector using the configured strategy (random locker
+	 * selection by default), unless it is run periodically by a background
+	 * thread (see kvs_start_detect()).
 	 * See https://docs.oracle.com/database/bdb181/html/programmer_reference/lock.html
 	 */
-	if ((flags & KVS_DEPOT_THREAD) || !(flags & KVS_DEPOT_PRIV)) {
-		err = depot->env->set_lk_detect(depot->env, DB_LOCK_DEFAULT);
+	if (((flags & KVS_DEPOT_THREAD) || !(flags & KVS_DEPOT_PRIV)) &&
+	    !depot->priv->detect_period) {
+		err = depot->env->set_lk_detect(depot->env,
+		                                depot->priv->detect);
 		kvs_assert(!err);
 	}
 
-	/* Open environment with transaction and automatic recovery support. */
+	/*
+	 * Release resources left behind by dead processes instead of running
+	 * full recovery whenever possible.
+	 */
+	if (conf && conf->failchk)
+		flags |= DB_FAILCHK;
+
+	if (!recover)
+		kvs_env_dbg(depot->env,
+		            "clean shutdown marker found: skipping recovery");
+
+	/*
+	 * Open environment with transaction and automatic recovery support.
+	 * When shared between processes, DB_REGISTER makes libdb run recovery
+	 * only if needed, i.e. if a process died while using the depot.
+	 */
+	start = kvs_now_usec();
 	err = depot->env->open(depot->env,
 	                       path,
 	                       DB_INIT_MPOOL |
 	                       DB_INIT_TXN |
-	                       DB_RECOVER |
+	                       recover |
 	                       DB_CREATE |
 	                       flags,
 	                       mode & ~(S_IXUSR | S_IXGRP | S_IXOTH));
 	kvs_assert(err != EINVAL);
+	if ((err == DB_RUNRECOVERY) && !recover) {
+		/*
+		 * A process sharing the depot died since it was cleanly
+		 * closed: marker is gone so that reopening runs recovery.
+		 */
+		kvs_env_dbg(depot->env,
+		            "dead process detected: running recovery");
+		depot->env->close(depot->env, 0);
+		kvs_free_depot_priv(depot->priv);
+
+		return kvs_open_depot_conf(depot,
+		                           path,
+		                           max_log_size,
+		                           conf,
+		                           oflags,
+		                           mode);
+	}
 	if (err)
 		/*
 		 * When opening fails, environment must be closed to discard
@@ -880,7 +3115,27 @@ kvs_open_depot(struct kvs_depot *depot,
 		 */
 		goto err;
 
+	depot->priv->startup.env_open = kvs_now_usec() - start;
+	kvs_env_dbg(depot->env,
+	            "environment opened in %llu us",
+	            depot->priv->startup.env_open);
+
+	start = kvs_now_usec();
 	depot->env->txn_checkpoint(depot->env, 0, 0, 0);
+	depot->priv->startup.ckpt = kvs_now_usec() - start;
+	kvs_env_dbg(depot->env,
+	            "environment checkpointed in %llu us",
+	            depot->priv->startup.ckpt);
+
+	if (depot->priv->detect_period) {
+		err = kvs_start_detect(depot);
+		if (err) {
+			kvs_close_depot(depot);
+			return err;
+		}
+	}
+
+	depot->priv->fast_open = conf && conf->fast_open;
 
 	return 0;
 
@@ -892,6 +3147,31 @@ err:
 	kvs_close_depot(depot);
 
 	return kvs_err_from_bdb(err);
+
+discard:
+	/* Discard environment handle which has not been opened yet. */
+	depot->env->close(depot->env, 0);
+	kvs_free_depot_priv(depot->priv);
+
+	return err;
+}
+
+int
+kvs_open_depot(struct kvs_depot *depot,
+               const char       *path,
+               size_t            max_log_size,
+               unsigned int      flags,
+               mode_t            mode)
+{
+	return kvs_open_depot_conf(depot, path, max_log_size, NULL, flags, mode);
+}
+
+int
+kvs_check_depot(const struct kvs_depot *depot)
+{
+	kvs_assert_depot(depot);
+
+	return kvs_err_from_bdb(depot->env->failchk(depot->env, 0));
 }
 
 void
@@ -34,16 +34,17 @@ kvs_strrec_fill_rec(const DBT        *key,
 	item->size = itm->size;
 }
 
-int
-kvs_strrec_iter_first(const struct kvs_iter *iter,
-                      struct kvs_chunk      *id,
-                      struct kvs_chunk      *item)
+static int
+kvs_strrec_iter_goto(const struct kvs_iter *iter,
+                     struct kvs_chunk      *id,
+                     struct kvs_chunk      *item,
+                     kvs_iter_goto_fn      *iter_goto)
 {
 	DBT key = { 0, };
 	DBT itm = { 0, };
 	int err;
 
-	err = kvs_iter_goto_first(iter, &key, &itm);
+	err = iter_goto(iter, &key, &itm);
 	if (err)
 		return err;
 
@@ -52,16 +53,53 @@ kvs_strrec_iter_first(const struct kvs_iter *iter,
 	return 0;
 }
 
+int
+kvs_strrec_iter_first(const struct kvs_iter *iter,
+                      struct kvs_chunk      *id,
+                      struct kvs_chunk      *item)
+{
+	return kvs_strrec_iter_goto(iter, id, item, kvs_iter_goto_first);
+}
+
 int
 kvs_strrec_iter_next(const struct kvs_iter *iter,
                      struct kvs_chunk      *id,
                      struct kvs_chunk      *item)
 {
-	DBT key = { 0, };
+	return kvs_strrec_iter_goto(iter, id, item, kvs_iter_goto_next);
+}
+
+int
+kvs_strrec_iter_last(const struct kvs_iter *iter,
+                     struct kvs_chunk      *id,
+                     struct kvs_chunk      *item)
+{
+	return kvs_strrec_iter_goto(iter, id, item, kvs_iter_goto_last);
+}
+
+int
+kvs_strrec_iter_prev(const struct kvs_iter *iter,
+                     struct kvs_chunk      *id,
+                     struct kvs_chunk      *item)
+{
+	return kvs_strrec_iter_goto(iter, id, item, kvs_iter_goto_prev);
+}
+
+int
+kvs_strrec_iter_seek(const struct kvs_iter  *iter,
+                     const struct kvs_chunk *from,
+                     struct kvs_chunk       *id,
+                     struct kvs_chunk       *item)
+{
+	kvs_assert(from);
+	kvs_assert(from->data);
+	kvs_assert(from->size);
+
+	DBT key = KVS_STRREC_INIT_KEY(from);
 	DBT itm = { 0, };
 	int err;
 
-	err = kvs_iter_goto_next(iter, &key, &itm);
+	err = kvs_iter_goto_seek(iter, &key, &itm);
 	if (err)
 		return err;
 
@@ -70,6 +108,185 @@ kvs_strrec_iter_next(const struct kvs_iter *iter,
 	return 0;
 }
 
+static void
+kvs_strrec_fill_field_rec(const DBT        *skey,
+                          struct kvs_chunk *field,
+                          const DBT        *pkey,
+                          struct kvs_chunk *id,
+                          const DBT        *itm,
+                          struct kvs_chunk *item)
+{
+	kvs_assert(skey);
+	kvs_assert(skey->data);
+	kvs_assert(skey->size);
+	kvs_assert(field);
+
+	field->size = skey->size;
+	field->data = skey->data;
+
+	kvs_strrec_fill_rec(pkey, id, itm, item);
+}
+
+static int
+kvs_strrec_field_iter_goto(const struct kvs_iter *iter,
+                           DBT                   *skey,
+                           struct kvs_chunk      *field,
+                           struct kvs_chunk      *id,
+                           struct kvs_chunk      *item,
+                           kvs_iter_pgoto_fn     *iter_goto)
+{
+	DBT pkey = { 0, };
+	DBT itm = { 0, };
+	int err;
+
+	err = iter_goto(iter, skey, &pkey, &itm);
+	if (err)
+		return err;
+
+	kvs_strrec_fill_field_rec(skey, field, &pkey, id, &itm, item);
+
+	return 0;
+}
+
+int
+kvs_strrec_field_iter_first(const struct kvs_iter *iter,
+                            struct kvs_chunk      *field,
+                            struct kvs_chunk      *id,
+                            struct kvs_chunk      *item)
+{
+	DBT skey = { 0, };
+
+	return kvs_strrec_field_iter_goto(iter,
+	                                  &skey,
+	                                  field,
+	                                  id,
+	                                  item,
+	                                  kvs_iter_pgoto_first);
+}
+
+int
+kvs_strrec_field_iter_next(const struct kvs_iter *iter,
+                           struct kvs_chunk      *field,
+                           struct kvs_chunk      *id,
+                           struct kvs_chunk      *item)
+{
+	DBT skey = { 0, };
+
+	return kvs_strrec_field_iter_goto(iter,
+	                                  &skey,
+	                                  field,
+	                                  id,
+	                                  item,
+	                                  kvs_iter_pgoto_next);
+}
+
+int
+kvs_strrec_field_iter_last(const struct kvs_iter *iter,
+                           struct kvs_chunk      *field,
+                           struct kvs_chunk      *id,
+                           struct kvs_chunk      *item)
+{
+	DBT skey = { 0, };
+
+	return kvs_strrec_field_iter_goto(iter,
+	                                  &skey,
+	                                  field,
+	                                  id,
+	                                  item,
+	                                  kvs_iter_pgoto_last);
+}
+
+int
+kvs_strrec_field_iter_prev(const struct kvs_iter *iter,
+                           struct kvs_chunk      *field,
+                           struct kvs_chunk      *id,
+                           struct kvs_chunk      *item)
+{
+	DBT skey = { 0, };
+
+	return kvs_strrec_field_iter_goto(iter,
+	                                  &skey,
+	                                  field,
+	                                  id,
+	                                  item,
+	                                  kvs_iter_pgoto_prev);
+}
+
+/*
+ * Position iterator onto the first index entry which field is greater than or
+ * equal to the one given in argument. On success, field is updated with the
+ * actual entry field.
+ */
+int
+kvs_strrec_field_iter_seek(const struct kvs_iter *iter,
+                           struct kvs_chunk      *field,
+                           struct kvs_chunk      *id,
+                           struct kvs_chunk      *item)
+{
+	kvs_assert(field);
+	kvs_assert(field->data);
+	kvs_assert(field->size);
+
+	DBT skey = KVS_CHUNK_INIT_DBT(field);
+
+	return kvs_strrec_field_iter_goto(iter,
+	                                  &skey,
+	                                  field,
+	                                  id,
+	                                  item,
+	                                  kvs_iter_pgoto_seek);
+}
+
+static int
+kvs_strrec_iter_byfield_goto(const struct kvs_iter *iter,
+                             struct kvs_chunk      *id,
+                             struct kvs_chunk      *item,
+                             kvs_iter_dups_fn      *iter_goto)
+{
+	kvs_assert(id);
+
+	DBT pkey = { 0, };
+	DBT itm = { 0, };
+	int err;
+
+	err = iter_goto(iter, &pkey, item ? &itm : NULL);
+	if (err)
+		return err;
+
+	if (!item) {
+		id->size = pkey.size;
+		id->data = pkey.data;
+		kvs_strrec_assert_id(id);
+
+		return 0;
+	}
+
+	kvs_strrec_fill_rec(&pkey, id, &itm, item);
+
+	return 0;
+}
+
+/*
+ * Walk primary records matching the field given at iterator initialization
+ * time (see kvs_strrec_init_byfield_iter()), sorted by id.
+ * When item is NULL, only ids are returned, sparing primary store lookups.
+ */
+int
+kvs_strrec_iter_byfield_first(const struct kvs_iter *iter,
+                              struct kvs_chunk      *id,
+                              struct kvs_chunk      *item)
+{
+	return kvs_strrec_iter_byfield_goto(iter, id, item, kvs_iter_dups_first);
+}
+
+int
+kvs_strrec_iter_byfield_next(const struct kvs_iter *iter,
+                             struct kvs_chunk      *id,
+                             struct kvs_chunk      *item)
+{
+	return kvs_strrec_iter_byfield_goto(iter, id, item, kvs_iter_dups_next);
+}
+
 int
 kvs_strrec_init_iter(const struct kvs_store *store,
                      const struct kvs_xact  *xact,
@@ -78,6 +295,65 @@ kvs_strrec_init_iter(const struct kvs_store *store,
 	return kvs_init_iter(store, xact, iter);
 }
 
+int
+kvs_strrec_init_bulk_iter(const struct kvs_store *store,
+                          const struct kvs_xact  *xact,
+                          struct kvs_iter        *iter,
+                          size_t                  size)
+{
+	return kvs_init_bulk_iter(store, xact, iter, size);
+}
+
+int
+kvs_strrec_init_range_iter(const struct kvs_store *store,
+                           const struct kvs_xact  *xact,
+                           struct kvs_iter        *iter,
+                           const struct kvs_range *range)
+{
+	kvs_assert(range);
+
+	return kvs_init_range_iter(store, xact, iter, range);
+}
+
+int
+kvs_strrec_init_field_iter(const struct kvs_store *index,
+                           const struct kvs_xact  *xact,
+                           struct kvs_iter        *iter,
+                           const struct kvs_range *range)
+{
+	kvs_assert(index);
+	kvs_assert(index->db);
+	kvs_assert(index->db->app_private);
+
+	return kvs_init_range_iter(index, xact, iter, range);
+}
+
+/*
+ * Initialize an iterator over all records which field, as indexed by the given
+ * duplicate-sorted index (see KVS_STORE_DUPSORT), matches the one given in
+ * argument. Matching ids are fetched in bulk using buffers of size bytes.
+ * field is referenced, not copied: it must remain valid until the iterator is
+ * finalized.
+ */
+int
+kvs_strrec_init_byfield_iter(const struct kvs_store *index,
+                             const struct kvs_xact  *xact,
+                             struct kvs_iter        *iter,
+                             const struct kvs_chunk *field,
+                             size_t                  size)
+{
+	kvs_assert(index);
+	kvs_assert(index->db);
+	kvs_assert(index->db->app_private);
+	kvs_assert(field);
+	kvs_assert(field->data);
+	kvs_assert(field->size);
+
+	const DBT skey = KVS_CHUNK_INIT_DBT(field);
+
+	return kvs_init_dups_iter(index, xact, iter, &skey, size);
+}
+
 int
 kvs_strrec_fini_iter(const struct kvs_iter *iter)
 {
@@ -112,6 +388,24 @@ kvs_strrec_get_byid(const struct kvs_store *store,
 	return 0;
 }
 
+int
+kvs_strrec_load_byid(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const struct kvs_chunk *id,
+                     void                   *data,
+                     size_t                 *size)
+{
+	kvs_strrec_assert_id(id);
+
+	DBT key = KVS_STRREC_INIT_KEY(id);
+	int ret;
+
+	ret = kvs_get_into(store, xact, &key, data, size);
+	kvs_assert(ret != DB_SECONDARY_BAD);
+
+	return ret;
+}
+
 int
 kvs_strrec_get_byfield(const struct kvs_store *index,
                        const struct kvs_xact  *xact,
@@ -177,6 +471,51 @@ kvs_strrec_put(const struct kvs_store *store,
 	return kvs_put(store, xact, &key, &itm, 0);
 }
 
+int
+kvs_strrec_put_batch(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const struct kvs_chunk *ids,
+                     const struct kvs_chunk *items,
+                     unsigned int            nr)
+{
+	kvs_assert(ids);
+	kvs_assert(items);
+	kvs_assert(nr);
+
+	DBT           bulk;
+	void         *ptr;
+	size_t        sz = 0;
+	unsigned int  r;
+	int           ret;
+
+	for (r = 0; r < nr; r++) {
+		kvs_strrec_assert_id(&ids[r]);
+		kvs_assert(items[r].data || !items[r].size);
+
+		sz += ids[r].size + items[r].size;
+	}
+
+	ret = kvs_init_bulk(&bulk, KVS_BULK_KEY_SIZE(nr, sz), &ptr);
+	if (ret)
+		return ret;
+
+	for (r = 0; r < nr; r++) {
+		DB_MULTIPLE_KEY_WRITE_NEXT(ptr,
+		                           &bulk,
+		                           ids[r].data,
+		                           ids[r].size,
+		                           items[r].data,
+		                           items[r].size);
+		kvs_assert(ptr);
+	}
+
+	ret = kvs_put_bulk(store, xact, &bulk);
+
+	kvs_fini_bulk(&bulk);
+
+	return ret;
+}
+
 int
 kvs_strrec_del_byid(const struct kvs_store *store,
                     const struct kvs_xact  *xact,
@@ -189,6 +528,43 @@ kvs_strrec_del_byid(const struct kvs_store *store,
 	return kvs_del(store, xact, &key);
 }
 
+int
+kvs_strrec_del_batch(const struct kvs_store *store,
+                     const struct kvs_xact  *xact,
+                     const struct kvs_chunk *ids,
+                     unsigned int            nr)
+{
+	kvs_assert(ids);
+	kvs_assert(nr);
+
+	DBT           bulk;
+	void         *ptr;
+	size_t        sz = 0;
+	unsigned int  r;
+	int           ret;
+
+	for (r = 0; r < nr; r++) {
+		kvs_strrec_assert_id(&ids[r]);
+
+		sz += ids[r].size;
+	}
+
+	ret = kvs_init_bulk(&bulk, KVS_BULK_SIZE(nr, sz), &ptr);
+	if (ret)
+		return ret;
+
+	for (r = 0; r < nr; r++) {
+		DB_MULTIPLE_WRITE_NEXT(ptr, &bulk, ids[r].data, ids[r].size);
+		kvs_assert(ptr);
+	}
+
+	ret = kvs_del_bulk(store, xact, &bulk);
+
+	kvs_fini_bulk(&bulk);
+
+	return ret;
+}
+
 int
 kvs_strrec_del_byfield(const struct kvs_store *index,
                        const struct kvs_xact  *xact,
@@ -204,6 +580,25 @@ kvs_strrec_del_byfield(const struct kvs_store *index,
 	return kvs_del(index, xact, &key);
 }
 
+int
+kvs_strrec_open_conf(struct kvs_store            *store,
+                     const struct kvs_depot      *depot,
+                     const struct kvs_xact       *xact,
+                     const char                  *path,
+                     const char                  *name,
+                     const struct kvs_store_conf *conf,
+                     mode_t                       mode)
+{
+	return kvs_open_store(store,
+	                      depot,
+	                      xact,
+	                      path,
+	                      name,
+	                      DB_BTREE,
+	                      conf,
+	                      mode);
+}
+
 int
 kvs_strrec_open(struct kvs_store       *store,
                 const struct kvs_depot *depot,
@@ -212,7 +607,7 @@ kvs_strrec_open(struct kvs_store       *store,
                 const char             *name,
                 mode_t                  mode)
 {
-	return kvs_open_store(store, depot, xact, path, name, DB_BTREE, mode);
+	return kvs_strrec_open_conf(store, depot, xact, path, name, NULL, mode);
 }
 
 int
@@ -1,6 +1,19 @@
 #include <kvstore/table.h>
 #include <errno.h>
 
+static int
+kvs_table_open_store(const struct kvs_table_store_ops *ops,
+                     struct kvs_table                 *table,
+                     const struct kvs_depot           *depot,
+                     const struct kvs_xact            *xact,
+                     mode_t                            mode)
+{
+	if (ops->open_conf)
+		return ops->open_conf(table, depot, xact, ops->conf, mode);
+
+	return ops->open(table, depot, xact, mode);
+}
+
 int
 kvs_table_open(struct kvs_table       *table,
                const struct kvs_depot *depot,
@@ -13,10 +26,14 @@ kvs_table_open(struct kvs_table       *table,
 	unsigned int                 cnt = 0;
 	int                          ret;
 
-	ret = desc->data_ops.open(table, depot, xact, mode);
+	ret = kvs_table_open_store(&desc->data_ops, table, depot, xact, mode);
 
 	while (!ret && (cnt < desc->indx_nr)) {
-		ret = desc->indx_ops[cnt].open(table, depot, xact, mode);
+		ret = kvs_table_open_store(&desc->indx_ops[cnt],
+		                           table,
+		                           depot,
+		                           xact,
+		                           mode);
 		cnt++;
 	}
 